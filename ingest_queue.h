@@ -0,0 +1,164 @@
+#ifndef INGEST_QUEUE_H
+#define INGEST_QUEUE_H
+
+#include "playlist.h"
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <ranges>
+#include <thread>
+#include <utility>
+
+namespace cxx
+{
+
+    // Bounded lock-free queue of {track, params} pairs with any number of
+    // producers and a single consumer, which moves them into a playlist.
+    //
+    // Each cell of the ring carries a sequence number telling whether it is
+    // free for the producer claiming that position or filled for the
+    // consumer. Producers claim positions with a compare-and-swap on the
+    // tail and never wait for each other or for the consumer, except when
+    // the ring is full. The consumer drains every filled cell in one
+    // append_range(), so the playlist is detached once per batch instead of
+    // once per pair.
+    template <typename T, typename P>
+    class ingest_queue
+    {
+    private:
+        struct alignas(64) Cell
+        {
+            std::atomic<size_t> seq;
+            // Empty when the producer failed to copy its pair.
+            std::optional<std::pair<T, P>> item;
+        };
+
+        std::unique_ptr<Cell[]> cells_;
+        size_t mask_;
+        alignas(64) std::atomic<size_t> tail_{0};
+        // Owned by the consumer.
+        alignas(64) size_t head_ = 0;
+
+    public:
+        // Creates an empty queue holding at least capacity pairs (rounded
+        // up to a power of two).
+        explicit ingest_queue(size_t capacity = 4096)
+            : cells_(std::make_unique<Cell[]>(
+                  std::bit_ceil(capacity < 2 ? size_t{2} : capacity))),
+              mask_(std::bit_ceil(capacity < 2 ? size_t{2} : capacity) - 1)
+        {
+            for (size_t i = 0; i <= mask_; ++i)
+            {
+                cells_[i].seq.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        ingest_queue(ingest_queue const &) = delete;
+        ingest_queue &operator=(ingest_queue const &) = delete;
+
+        // Adds {track, params} unless the queue is full. Safe to call from
+        // any number of threads at once. On exception the pair is not added.
+        // O(const), lock-free.
+        bool try_push(T const &track, P const &params)
+        {
+            size_t pos = tail_.load(std::memory_order_relaxed);
+            Cell *cell;
+            while (true)
+            {
+                cell = &cells_[pos & mask_];
+                size_t seq = cell->seq.load(std::memory_order_acquire);
+                auto diff = static_cast<std::ptrdiff_t>(seq - pos);
+                if (diff == 0)
+                {
+                    if (tail_.compare_exchange_weak(pos, pos + 1,
+                            std::memory_order_relaxed))
+                    {
+                        break;
+                    }
+                }
+                else if (diff < 0)
+                {
+                    return false;
+                }
+                else
+                {
+                    pos = tail_.load(std::memory_order_relaxed);
+                }
+            }
+
+            try
+            {
+                cell->item.emplace(track, params);
+            }
+            catch (...)
+            {
+                // The position is taken: publish it empty, so that the
+                // consumer skips it instead of waiting for it forever.
+                cell->seq.store(pos + 1, std::memory_order_release);
+                throw;
+            }
+            cell->seq.store(pos + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Adds {track, params}, yielding while the queue is full.
+        void push(T const &track, P const &params)
+        {
+            while (!try_push(track, params))
+            {
+                std::this_thread::yield();
+            }
+        }
+
+        // Moves at most max pairs, in the order their positions were claimed,
+        // to the end of the playlist and returns how many were taken off the
+        // queue. Must be called by one thread at a time. On exception the
+        // playlist is left as append_range leaves it and the pairs stay
+        // queued.
+        // O(k log n)
+        size_t drain(playlist<T, P> &pl,
+            size_t max = std::numeric_limits<size_t>::max())
+        {
+            size_t ready = 0;
+            while (ready < max && ready <= mask_ &&
+                cells_[(head_ + ready) & mask_].seq.load(
+                    std::memory_order_acquire) == head_ + ready + 1)
+            {
+                ++ready;
+            }
+            if (ready == 0)
+                return 0;
+
+            auto cells = std::views::iota(head_, head_ + ready) |
+                std::views::transform([this](size_t pos) -> Cell &
+                {
+                    return cells_[pos & mask_];
+                });
+            pl.append_range(cells |
+                std::views::filter([](Cell const &cell)
+                {
+                    return cell.item.has_value();
+                }) |
+                std::views::transform([](Cell const &cell)
+                {
+                    return std::pair<T const &, P const &>(
+                        cell.item->first, cell.item->second);
+                }));
+
+            for (Cell &cell : cells)
+            {
+                cell.item.reset();
+                cell.seq.store(head_ + 1 + mask_, std::memory_order_release);
+                ++head_;
+            }
+            return ready;
+        }
+    };
+
+} // namespace cxx
+
+#endif // INGEST_QUEUE_H
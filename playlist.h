@@ -1,38 +1,340 @@
 #ifndef PLAYLIST_H
 #define PLAYLIST_H
 
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <functional>
 #include <list>
 #include <map>
+#include <queue>
+#include <ranges>
 #include <memory>
+#include <mutex>
 #include <stdexcept>
 #include <utility>
 #include <iterator>
+#include <limits>
 #include <cstddef>
+#include <cstdint>
+#include <bit>
+#include <new>
+#include <optional>
+#include <span>
 #include <type_traits>
+#include <vector>
+
+// Counting of expensive operations, see cxx::playlist_stats. Without
+// CXX_PLAYLIST_STATS the hooks expand to nothing.
+#ifdef CXX_PLAYLIST_STATS
+#define CXX_PLAYLIST_COUNT(counter, n) \
+    (::cxx::playlist_stats::counters::counter.fetch_add( \
+        (n), std::memory_order_relaxed))
+#else
+#define CXX_PLAYLIST_COUNT(counter, n) ((void)0)
+#endif
+
+// Defining CXX_PLAYLIST_CHECKED_ITERATORS makes play and sorted iterators
+// carry a stamp of the data they were made from, so that stale ones can be
+// told apart and recovered, see playlist::valid() and playlist::rebind().
 
 namespace cxx
 {
 
+    // Totals over all playlists in the program, collected only when
+    // CXX_PLAYLIST_STATS is defined (all zero otherwise).
+    struct playlist_stats
+    {
+        size_t deep_copies = 0;      // copies of shared data
+        size_t entries_copied = 0;   // entries duplicated by those copies
+        size_t rollbacks = 0;        // copies dropped after a failed write
+        size_t node_allocations = 0; // list, map and data allocations
+        size_t index_lookups = 0;    // searches of a track in the index
+
+        static playlist_stats global() noexcept
+        {
+            playlist_stats result;
+#ifdef CXX_PLAYLIST_STATS
+            auto load = [](std::atomic<size_t> const &c)
+            {
+                return c.load(std::memory_order_relaxed);
+            };
+            result.deep_copies = load(counters::deep_copies);
+            result.entries_copied = load(counters::entries_copied);
+            result.rollbacks = load(counters::rollbacks);
+            result.node_allocations = load(counters::node_allocations);
+            result.index_lookups = load(counters::index_lookups);
+#endif
+            return result;
+        }
+
+        static void reset() noexcept
+        {
+#ifdef CXX_PLAYLIST_STATS
+            counters::deep_copies = 0;
+            counters::entries_copied = 0;
+            counters::rollbacks = 0;
+            counters::node_allocations = 0;
+            counters::index_lookups = 0;
+#endif
+        }
+
+#ifdef CXX_PLAYLIST_STATS
+        struct counters
+        {
+            static inline std::atomic<size_t> deep_copies{0};
+            static inline std::atomic<size_t> entries_copied{0};
+            static inline std::atomic<size_t> rollbacks{0};
+            static inline std::atomic<size_t> node_allocations{0};
+            static inline std::atomic<size_t> index_lookups{0};
+        };
+#endif
+    };
+
+    // Thread-local free lists of small blocks. Playlist nodes are small and
+    // of a few fixed sizes, so short-lived playlists get their memory back
+    // from here instead of from operator new. Blocks freed on another thread
+    // simply join that thread's lists, and every thread keeps up to
+    // max_cached blocks per size class. The pool is off unless
+    // CXX_PLAYLIST_NODE_POOL is defined: blocks it keeps are never freed, so
+    // memory checkers would miss uses after free.
+    class node_pool
+    {
+    public:
+        static constexpr size_t granularity = 16;
+        static constexpr size_t max_block = 256;
+        static constexpr size_t max_cached = 1024;
+
+        static bool pooled(size_t bytes, size_t alignment) noexcept
+        {
+#ifdef CXX_PLAYLIST_NODE_POOL
+            return bytes <= max_block &&
+                alignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+#else
+            (void)bytes;
+            (void)alignment;
+            return false;
+#endif
+        }
+
+        // Size of the block actually handed out for a pooled request.
+        static size_t block_size(size_t bytes) noexcept
+        {
+            return (size_class(bytes) + 1) * granularity;
+        }
+
+        static void *allocate(size_t bytes)
+        {
+            lists &l = local();
+            size_t c = size_class(bytes);
+            if (block *b = l.head[c])
+            {
+                l.head[c] = b->next;
+                --l.count[c];
+                return b;
+            }
+            return ::operator new((c + 1) * granularity);
+        }
+
+        static void deallocate(void *p, size_t bytes) noexcept
+        {
+            lists &l = local();
+            size_t c = size_class(bytes);
+            if (l.closed || l.count[c] >= max_cached)
+            {
+                ::operator delete(p);
+                return;
+            }
+            l.head[c] = ::new (p) block{l.head[c]};
+            ++l.count[c];
+        }
+
+    private:
+        static constexpr size_t classes = max_block / granularity;
+
+        struct block
+        {
+            block *next;
+        };
+
+        // Trivially destructible, so it stays usable after the thread's
+        // cleanup has run (blocks then go straight to operator delete).
+        struct lists
+        {
+            block *head[classes];
+            size_t count[classes];
+            bool closed;
+        };
+
+        struct cleanup
+        {
+            lists &l;
+
+            ~cleanup()
+            {
+                for (size_t c = 0; c < classes; ++c)
+                {
+                    while (block *b = l.head[c])
+                    {
+                        l.head[c] = b->next;
+                        ::operator delete(b);
+                    }
+                    l.count[c] = 0;
+                }
+                l.closed = true;
+            }
+        };
+
+        static size_t size_class(size_t bytes) noexcept
+        {
+            return bytes == 0 ? 0 : (bytes - 1) / granularity;
+        }
+
+        static lists &local() noexcept
+        {
+            thread_local lists l{};
+            thread_local cleanup guard{l};
+            return l;
+        }
+    };
+
+    // Stateless allocator drawing single objects from node_pool. All
+    // instances compare equal, so nodes can be spliced between playlists.
+    // If Tag is given, Tag::bytes remembers the size of the blocks handed
+    // out, which is the size of the container's node type.
+    template <typename U, typename Tag = void>
+    struct node_allocator
+    {
+        using value_type = U;
+
+        node_allocator() noexcept = default;
+
+        template <typename V>
+        node_allocator(node_allocator<V, Tag> const &) noexcept {}
+
+        U *allocate(size_t n)
+        {
+            CXX_PLAYLIST_COUNT(node_allocations, 1);
+            bool pooled = n == 1 && node_pool::pooled(sizeof(U), alignof(U));
+            if constexpr (!std::is_void_v<Tag>)
+            {
+                if (n == 1 && Tag::bytes.load(std::memory_order_relaxed) == 0)
+                {
+                    Tag::bytes.store(pooled ? node_pool::block_size(sizeof(U))
+                                            : sizeof(U),
+                        std::memory_order_relaxed);
+                }
+            }
+            if (pooled)
+                return static_cast<U *>(node_pool::allocate(sizeof(U)));
+            return std::allocator<U>().allocate(n);
+        }
+
+        void deallocate(U *p, size_t n) noexcept
+        {
+            if (n == 1 && node_pool::pooled(sizeof(U), alignof(U)))
+                node_pool::deallocate(p, sizeof(U));
+            else
+                std::allocator<U>().deallocate(p, n);
+        }
+
+        template <typename V>
+        bool operator==(node_allocator<V, Tag> const &) const noexcept
+        {
+            return true;
+        }
+    };
+
+    // Declares that the values of an integral or enumeration track type lie
+    // in [min, max], so that the playlist can find index nodes through a
+    // table with one slot per value instead of walking the tree. Holds for
+    // one-byte types out of the box; specialise it for other types with a
+    // small range (tracks outside the range still work, without the table).
+    template <typename T, typename = void>
+    struct track_key_range
+    {
+        static constexpr bool bounded = false;
+    };
+
+    template <typename T>
+    struct track_key_range<T, std::enable_if_t<
+        (std::is_integral_v<T> || std::is_enum_v<T>) && sizeof(T) == 1>>
+    {
+        using underlying = typename std::conditional_t<std::is_enum_v<T>,
+            std::underlying_type<T>, std::type_identity<T>>::type;
+        static constexpr bool bounded = true;
+        static constexpr std::int64_t min =
+            std::numeric_limits<underlying>::min();
+        static constexpr std::int64_t max =
+            std::numeric_limits<underlying>::max();
+    };
+
+    // Memory used by the data of a playlist, as reported by
+    // playlist::memory_usage(). Memory owned by T and P themselves (e.g.
+    // string characters) is not included.
+    struct playlist_memory
+    {
+        size_t sequence_nodes = 0;   // entries in play order
+        size_t occurrence_nodes = 0; // per-track lists of entries
+        size_t index_nodes = 0;      // sorted index of tracks
+        size_t other = 0;            // data block and random access layer
+        size_t owners = 0;           // playlists sharing the data
+        size_t shared = 0;           // part of total shared with copies
+        size_t exclusive = 0;        // part of total owned by one playlist
+
+        size_t total() const noexcept
+        {
+            return sequence_nodes + occurrence_nodes + index_nodes + other;
+        }
+    };
+
+    template <typename T, typename P>
+    class playlist;
+
+    template <typename T, typename P, typename Proj,
+        typename Comp = std::ranges::less>
+    playlist<T, P> merge_interleaved(playlist<T, P> const &a,
+        playlist<T, P> const &b, Proj proj, Comp comp = {});
+
     template <typename T, typename P>
     class playlist
     {
     private:
+        template <typename T2, typename P2, typename Proj, typename Comp>
+        friend playlist<T2, P2> merge_interleaved(playlist<T2, P2> const &,
+            playlist<T2, P2> const &, Proj, Comp);
+
         struct Entry;
         bool forceCopy = false;
 
+        // Node sizes recorded by node_allocator, one per kind of node.
+        template <int Kind>
+        struct NodeBytes
+        {
+            static inline std::atomic<size_t> bytes{0};
+        };
+        using SequenceNodes = NodeBytes<0>;
+        using OccurrenceNodes = NodeBytes<1>;
+        using IndexNodes = NodeBytes<2>;
+        using DataNodes = NodeBytes<3>;
+
         // Type aliases.
 
         // List ordered by adding order.
-        using SequenceList = std::list<Entry>;
+        using SequenceList =
+            std::list<Entry, node_allocator<Entry, SequenceNodes>>;
         using SequenceIterator = typename SequenceList::iterator;
         using ConstSequenceIterator = typename SequenceList::const_iterator;
 
         // List of iterators to the sequence list for instant access.
-        using OccurrencesList = std::list<SequenceIterator>;
+        using OccurrencesList =
+            std::list<SequenceIterator,
+                node_allocator<SequenceIterator, OccurrenceNodes>>;
         using OccurrencesIterator = typename OccurrencesList::iterator;
 
         // Sorted map, which gives chronological order.
-        using IndexMap = std::map<T, OccurrencesList>;
+        using IndexMap = std::map<T, OccurrencesList, std::less<T>,
+            node_allocator<std::pair<T const, OccurrencesList>, IndexNodes>>;
         using IndexIterator = typename IndexMap::iterator;
         using ConstIndexIterator = typename IndexMap::const_iterator;
 
@@ -42,6 +344,11 @@ namespace cxx
             mutable P params;
             IndexIterator map_it;
             OccurrencesIterator distinct_it;
+            // Label growing along the sequence, so that the play order of two
+            // entries can be compared without walking the list.
+            std::uint64_t order = 0;
+            // Identity of the entry, kept by copies (see entry_id).
+            std::uint64_t id = 0;
 
             Entry(P const &p,
                 IndexIterator m_it,
@@ -52,18 +359,451 @@ namespace cxx
             : params(p) {}
         };
 
+        // Key of the flat index: small trivially copyable tracks are stored
+        // in place, so lookups scan contiguous memory; others by pointer.
+        static constexpr bool flat_inline_keys =
+            std::is_trivially_copyable_v<T> && sizeof(T) <= 2 * sizeof(void *);
+
+        struct FlatEntry
+        {
+            std::conditional_t<flat_inline_keys, T, T const *> key;
+            ConstIndexIterator node;
+
+            explicit FlatEntry(ConstIndexIterator it) noexcept
+                : key(flat_key(it)), node(it) {}
+
+            static auto flat_key(ConstIndexIterator it) noexcept
+            {
+                if constexpr (flat_inline_keys)
+                    return it->first;
+                else
+                    return &it->first;
+            }
+
+            T const &track() const noexcept
+            {
+                if constexpr (flat_inline_keys)
+                    return key;
+                else
+                    return *key;
+            }
+
+            bool operator<(FlatEntry const &other) const
+            {
+                return track() < other.track();
+            }
+        };
+
+        // Whether index nodes are also reachable through a table indexed by
+        // the value of the track (see track_key_range).
+        using KeyRange = track_key_range<T>;
+        static constexpr bool direct_index = KeyRange::bounded;
+        struct NoTable {};
+
         // The structure that stores all the data in the playlist.
         struct Impl
         {
             SequenceList sequence;
             IndexMap index;
 
-            // Adds the {iterator, param} to the sequence and updates map {track,
-            // list of iterators to the position at list}.
-            void insert_track(T const &track, P const &params)
+#ifdef CXX_PLAYLIST_CHECKED_ITERATORS
+            // Unique over all data of the type, never reused. The generation
+            // is replaced whenever an entry may have been unlinked, so that
+            // iterators made before know they are stale; the labelling is
+            // replaced by relabel() and taken over by copies, which keep the
+            // labels.
+            std::uint64_t generation = next_stamp();
+            std::uint64_t labelling = generation;
+
+            static std::uint64_t next_stamp() noexcept
+            {
+                static std::atomic<std::uint64_t> last{0};
+                return last.fetch_add(1, std::memory_order_relaxed) + 1;
+            }
+#endif
+
+            // Marks the iterators to the entries as stale (in checked mode).
+            void entries_unlinked() noexcept
+            {
+#ifdef CXX_PLAYLIST_CHECKED_ITERATORS
+                generation = next_stamp();
+#endif
+            }
+
+            // Lazy layers below are built by const readers, possibly of
+            // several playlists sharing the data from several threads. Shared
+            // data is never written (writers detach first), so a layer once
+            // marked current stays so while readers use it; building takes
+            // the mutex and publishes the flag with release ordering.
+            mutable std::mutex layers_mutex;
+
+            template <typename Build>
+            void build_layer(std::atomic<bool> &current, Build &&build) const
             {
+                if (current.load(std::memory_order_acquire))
+                    return;
+                std::lock_guard<std::mutex> lock(layers_mutex);
+                if (current.load(std::memory_order_relaxed))
+                    return;
+                build();
+                current.store(true, std::memory_order_release);
+            }
+
+            // Random access layer over the sequence, dropped by every
+            // structural change.
+            mutable std::vector<ConstSequenceIterator> positions;
+            mutable std::atomic<bool> positions_valid{false};
+
+            void invalidate() noexcept
+            {
+                if (positions_valid.load(std::memory_order_relaxed))
+                {
+                    positions_valid.store(false, std::memory_order_relaxed);
+                    positions.clear();
+                }
+            }
+
+            // Sorted array of tracks for read-mostly use, kept under the same
+            // rules as positions. Tracks added while it is valid wait in an
+            // unsorted delta which the next reader sorts and merges in;
+            // removing a track drops the array.
+            // flat_current means valid with the delta merged in.
+            mutable std::vector<FlatEntry> flat;
+            mutable std::vector<FlatEntry> flat_delta;
+            mutable bool flat_valid = false;
+            mutable std::atomic<bool> flat_current{false};
+
+            void drop_flat() noexcept
+            {
+                if (flat_valid)
+                {
+                    flat_valid = false;
+                    flat_current.store(false, std::memory_order_relaxed);
+                    flat.clear();
+                    flat_delta.clear();
+                }
+            }
+
+            void note_new_track(ConstIndexIterator it) noexcept
+            {
+                if (!flat_valid)
+                    return;
+                try
+                {
+                    flat_delta.emplace_back(it);
+                    flat_current.store(false, std::memory_order_relaxed);
+                }
+                catch (...)
+                {
+                    drop_flat();
+                }
+            }
+
+            // Entries sorted by id for find(), under the same rules as the
+            // flat index. A new entry has the largest id there is, so it is
+            // appended; an unlinked entry leaves a hole (sequence.end()),
+            // and the array is dropped once half of it are holes.
+            mutable std::vector<std::pair<std::uint64_t, ConstSequenceIterator>>
+                by_id;
+            mutable size_t by_id_holes = 0;
+            mutable std::atomic<bool> by_id_valid{false};
+
+            static std::uint64_t next_id() noexcept
+            {
+                static std::atomic<std::uint64_t> last{0};
+                return last.fetch_add(1, std::memory_order_relaxed) + 1;
+            }
+
+            void drop_ids() noexcept
+            {
+                if (by_id_valid.load(std::memory_order_relaxed))
+                {
+                    by_id_valid.store(false, std::memory_order_relaxed);
+                    by_id.clear();
+                }
+            }
+
+            void note_new_entry(ConstSequenceIterator it) noexcept
+            {
+                if (!by_id_valid.load(std::memory_order_relaxed))
+                    return;
+                try
+                {
+                    by_id.emplace_back(it->id, it);
+                }
+                catch (...)
+                {
+                    drop_ids();
+                }
+            }
+
+            void note_unlinked_entry(ConstSequenceIterator it) noexcept
+            {
+                if (!by_id_valid.load(std::memory_order_relaxed))
+                    return;
+                auto slot = std::lower_bound(by_id.begin(), by_id.end(),
+                    it->id, [](auto const &e, std::uint64_t id)
+                    { return e.first < id; });
+                slot->second = sequence.end();
+                if (++by_id_holes * 2 > by_id.size())
+                    drop_ids();
+            }
+
+            // Gets the entry with the id, sequence.end() if there is none.
+            // O(n log n) on first use after the array was dropped, O(log n)
+            // otherwise.
+            ConstSequenceIterator find_entry(std::uint64_t id) const
+            {
+                build_layer(by_id_valid, [&]
+                {
+                    by_id.clear();
+                    by_id.reserve(sequence.size());
+                    for (auto it = sequence.begin(); it != sequence.end(); ++it)
+                    {
+                        by_id.emplace_back(it->id, it);
+                    }
+                    std::sort(by_id.begin(), by_id.end(),
+                        [](auto const &a, auto const &b)
+                        { return a.first < b.first; });
+                    by_id_holes = 0;
+                });
+                auto slot = std::lower_bound(by_id.begin(), by_id.end(), id,
+                    [](auto const &e, std::uint64_t key) { return e.first < key; });
+                if (slot == by_id.end() || slot->first != id)
+                    return sequence.end();
+                return slot->second;
+            }
+
+            // One slot per value of the key range, index.end() for absent
+            // tracks. Allocated before the first insertion.
+            [[no_unique_address]] std::conditional_t<direct_index,
+                std::vector<IndexIterator>, NoTable> table;
+
+            static constexpr size_t no_slot = static_cast<size_t>(-1);
+
+            // Gets the slot of the track, no_slot outside the key range.
+            static size_t slot([[maybe_unused]] T const &track) noexcept
+            {
+                if constexpr (direct_index)
+                {
+                    std::int64_t value;
+                    if constexpr (std::is_enum_v<T>)
+                        value = static_cast<std::int64_t>(std::to_underlying(track));
+                    else
+                        value = static_cast<std::int64_t>(track);
+                    if (value >= KeyRange::min && value <= KeyRange::max)
+                        return static_cast<size_t>(value - KeyRange::min);
+                }
+                return no_slot;
+            }
+
+            void prepare_table()
+            {
+                if constexpr (direct_index)
+                {
+                    if (table.empty())
+                    {
+                        table.assign(static_cast<size_t>(
+                            KeyRange::max - KeyRange::min) + 1, index.end());
+                    }
+                }
+            }
+
+            void clear_table() noexcept
+            {
+                if constexpr (direct_index)
+                    table.clear();
+            }
+
+            void set_slot([[maybe_unused]] T const &track,
+                [[maybe_unused]] IndexIterator it) noexcept
+            {
+                if constexpr (direct_index)
+                {
+                    size_t at = slot(track);
+                    if (at < table.size())
+                        table[at] = it;
+                }
+            }
+
+            // Finds the index node of the track or, if there is none, the
+            // first node after it.
+            // O(const) through the table, O(log d) otherwise.
+            IndexIterator locate(T const &track)
+            {
+                if constexpr (direct_index)
+                {
+                    size_t at = slot(track);
+                    if (at < table.size() && table[at] != index.end())
+                        return table[at];
+                }
+                return index.lower_bound(track);
+            }
+
+            // Finds the index node of the track, index.end() if there is none.
+            // O(const) through the table, O(log d) otherwise.
+            ConstIndexIterator find(T const &track) const
+            {
+                if constexpr (direct_index)
+                {
+                    size_t at = slot(track);
+                    if (at < table.size())
+                        return table[at];
+                }
+                return index.find(track);
+            }
+
+            // Records a new index node in the table and the flat index.
+            void index_added(IndexIterator it) noexcept
+            {
+                set_slot(it->first, it);
+                note_new_track(it);
+            }
+
+            // Erases an index node along with its traces in the table and the
+            // flat index.
+            void index_erase(ConstIndexIterator it) noexcept
+            {
+                set_slot(it->first, index.end());
+                drop_flat();
+                index.erase(it);
+            }
+
+            void clear() noexcept
+            {
+                entries_unlinked();
+                invalidate();
+                drop_flat();
+                drop_ids();
+                clear_table();
+                sequence.clear();
+                index.clear();
+            }
+
+            // Gets the tracks in sorted order as a contiguous array.
+            // O(d) on first use after a track was removed, O(m log m + d)
+            // after m tracks were added, O(const) otherwise.
+            std::vector<FlatEntry> const &flat_index() const
+            {
+                build_layer(flat_current, [&]
+                {
+                    if (!flat_valid)
+                    {
+                        flat.clear();
+                        flat_delta.clear();
+                        flat.reserve(index.size());
+                        for (auto it = index.begin(); it != index.end(); ++it)
+                        {
+                            flat.emplace_back(it);
+                        }
+                        flat_valid = true;
+                    }
+                    else if (!flat_delta.empty())
+                    {
+                        std::sort(flat_delta.begin(), flat_delta.end());
+                        size_t middle = flat.size();
+                        flat.insert(flat.end(), flat_delta.begin(),
+                            flat_delta.end());
+                        flat_valid = false;
+                        std::inplace_merge(flat.begin(),
+                            flat.begin() + static_cast<std::ptrdiff_t>(middle),
+                            flat.end());
+                        flat_valid = true;
+                        flat_delta.clear();
+                    }
+                });
+                return flat;
+            }
+
+            // Finds the track in the flat index.
+            // O(log d) (see flat_index for the upkeep)
+            FlatEntry const *flat_find(T const &track) const
+            {
+                auto const &entries = flat_index();
+                auto it = std::lower_bound(entries.begin(), entries.end(), track,
+                    [](FlatEntry const &e, T const &t) { return e.track() < t; });
+                if (it == entries.end() || track < it->track())
+                    return nullptr;
+                return &*it;
+            }
+
+            // Gets iterators to all entries in play order.
+            // O(n) on first use after a change, O(const) afterwards.
+            std::vector<ConstSequenceIterator> const &random_access() const
+            {
+                build_layer(positions_valid, [&]
+                {
+                    positions.clear();
+                    positions.reserve(sequence.size());
+                    for (auto it = sequence.begin(); it != sequence.end(); ++it)
+                    {
+                        positions.push_back(it);
+                    }
+                });
+                return positions;
+            }
+
+            // Gap between the labels of consecutive entries after renumbering,
+            // leaving room for 32 halvings by insertions between them.
+            static constexpr std::uint64_t label_step = std::uint64_t(1) << 32;
+
+            // Renumbers all entries, spacing the labels evenly.
+            // O(n)
+            void relabel() noexcept
+            {
+#ifdef CXX_PLAYLIST_CHECKED_ITERATORS
+                labelling = next_stamp();
+#endif
+                std::uint64_t label = label_step;
+                for (auto &e : sequence)
+                {
+                    e.order = label;
+                    label += label_step;
+                }
+            }
+
+            // Gets a label for a new entry placed before pos, renumbering the
+            // entries when there is no room left between the neighbours.
+            std::uint64_t label_before(ConstSequenceIterator pos) noexcept
+            {
+                if (pos == sequence.end())
+                {
+                    if (sequence.empty())
+                        return label_step;
+                    if (sequence.back().order > UINT64_MAX - label_step)
+                        relabel();
+                    return sequence.back().order + label_step;
+                }
+                if (pos == sequence.begin())
+                {
+                    // A full step back if popped entries left room, as in
+                    // pop_front() followed by an insert() at the front.
+                    if (pos->order > label_step)
+                        return pos->order - label_step;
+                    if (pos->order == 0)
+                        relabel();
+                    return pos->order / 2;
+                }
+                if (pos->order - std::prev(pos)->order < 2)
+                    relabel();
+                std::uint64_t low = std::prev(pos)->order;
+                return low + (pos->order - low) / 2;
+            }
+
+            // Adds the {track, params} to the sequence before pos and updates
+            // map {track, list of iterators to the position at list}, keeping
+            // the list in play order. The list is scanned from both ends at
+            // once, so the i-th of k occurrences takes O(min(i, k - i)) steps
+            // and an entry added at the end O(const).
+            SequenceIterator insert_before(ConstSequenceIterator pos,
+                T const &track, P const &params)
+            {
+                prepare_table();
+                invalidate();
+                std::uint64_t label = label_before(pos);
                 // Try to add to the map
-                auto target_it = index.lower_bound(track);
+                CXX_PLAYLIST_COUNT(index_lookups, 1);
+                auto target_it = locate(track);
                 bool insert_new = false;
                 if (target_it == index.end() || target_it->first != track)
                 {
@@ -72,10 +812,27 @@ namespace cxx
                     insert_new = true;
                 }
 
+                // Occurrences in [begin, low) come before the new entry and
+                // those in [high, end) after it.
+                OccurrencesList &occurrences = target_it->second;
+                auto low = occurrences.begin(), high = occurrences.end();
+                while (low != high)
+                {
+                    if ((*low)->order > label)
+                    {
+                        high = low;
+                        break;
+                    }
+                    if (++low == high || (*std::prev(high))->order < label)
+                        break;
+                    --high;
+                }
+
                 // Prepare for allocation error.
+                OccurrencesIterator occurrence_it;
                 try
                 {
-                    target_it->second.push_back(sequence.end());
+                    occurrence_it = occurrences.insert(high, sequence.end());
                 }
                 catch (...)
                 {
@@ -84,30 +841,415 @@ namespace cxx
                     throw;
                 }
 
-                auto occurrence_it = std::prev(target_it->second.end());
                 // Add and handle allocation error.
                 try
                 {
                     // Add to main list.
-                    sequence.emplace_back(params, target_it, occurrence_it);
+                    auto seq_it = sequence.emplace(
+                        pos, params, target_it, occurrence_it);
+                    seq_it->order = label;
+                    seq_it->id = next_id();
                     // Aktualizacja iteratora w mapie
-                    *occurrence_it = std::prev(sequence.end());
+                    *occurrence_it = seq_it;
+                    if (insert_new)
+                        index_added(target_it);
+                    note_new_entry(seq_it);
+                    return seq_it;
                 }
                 catch (...)
                 {
-                    target_it->second.pop_back();
-                    if (target_it->second.empty())
+                    occurrences.erase(occurrence_it);
+                    if (occurrences.empty())
                     {
                         index.erase(target_it);
                     }
                     throw;
                 }
             }
+
+            // Adds the {track, params} at the end of the sequence.
+            void insert_track(T const &track, P const &params)
+            {
+                insert_before(sequence.end(), track, params);
+            }
+
+            // Whether comparing tracks cannot throw, so that index nodes can
+            // be moved between maps without risking a half-done change.
+            static constexpr bool compare_nothrow =
+                requires(T const &a) { { a < a } noexcept; };
+
+            // Whether the oldest entry can be reused in place without risking
+            // an exception after the structure has been modified.
+            static constexpr bool recycle_nothrow =
+                std::is_nothrow_move_assignable_v<T> &&
+                std::is_nothrow_move_assignable_v<P> && compare_nothrow;
+
+            // Drops the first entry and adds {track, params} at the end.
+            // When possible the nodes of the dropped entry (sequence node,
+            // occurrence node and, if the track disappears, the index node)
+            // are reused, so no allocation takes place.
+            void replace_front(T const &track, P const &params)
+            {
+                if constexpr (!recycle_nothrow)
+                {
+                    insert_track(track, params);
+                    erase_entry(sequence.begin());
+                }
+                else
+                {
+                    P value(params);
+                    invalidate();
+                    entries_unlinked();
+                    auto node = sequence.begin();
+                    IndexIterator old_it = node->map_it;
+                    CXX_PLAYLIST_COUNT(index_lookups, 1);
+                    auto target_it = locate(track);
+
+                    if (target_it != index.end() && !(track < target_it->first))
+                    {
+                        // Known track, move the occurrence to its list.
+                        target_it->second.splice(target_it->second.end(),
+                            old_it->second, node->distinct_it);
+                        if (target_it != old_it && old_it->second.empty())
+                        {
+                            index_erase(old_it);
+                        }
+                    }
+                    else if (old_it->second.size() == 1)
+                    {
+                        // The old track disappears, rename its index node.
+                        T key(track);
+                        if (target_it == old_it)
+                            ++target_it;
+                        drop_flat();
+                        set_slot(old_it->first, index.end());
+                        auto handle = index.extract(old_it);
+                        handle.key() = std::move(key);
+                        target_it = index.insert(target_it, std::move(handle));
+                        index_added(target_it);
+                    }
+                    else
+                    {
+                        target_it = index.emplace_hint(
+                            target_it, track, OccurrencesList{});
+                        target_it->second.splice(target_it->second.end(),
+                            old_it->second, node->distinct_it);
+                        index_added(target_it);
+                    }
+
+                    note_unlinked_entry(node);
+                    node->map_it = target_it;
+                    node->params = std::move(value);
+                    node->order = label_before(sequence.end());
+                    node->id = next_id();
+                    sequence.splice(sequence.end(), sequence, node);
+                    note_new_entry(node);
+                }
+            }
+
+            // Computes a play order in which two occurrences of the same track
+            // are separated by at least spacing other entries. Tracks keep the
+            // relative order of their own occurrences. Greedily picks the track
+            // with the most remaining occurrences among those not played in
+            // the last spacing slots, which finds an order whenever one exists.
+            // Returns a shorter vector if there is none.
+            // O(n log d)
+            std::vector<ConstSequenceIterator> spread(size_t spacing) const
+            {
+                std::vector<ConstSequenceIterator> order;
+                order.reserve(sequence.size());
+                if (spacing == 0)
+                {
+                    for (auto it = sequence.begin(); it != sequence.end(); ++it)
+                    {
+                        order.push_back(it);
+                    }
+                    return order;
+                }
+
+                struct Pending
+                {
+                    size_t remaining;
+                    size_t rank;
+                    typename OccurrencesList::const_iterator next;
+
+                    bool operator<(Pending const &other) const noexcept
+                    {
+                        if (remaining != other.remaining)
+                            return remaining < other.remaining;
+                        return rank > other.rank;
+                    }
+                };
+
+                std::priority_queue<Pending> ready;
+                std::deque<std::pair<size_t, Pending>> cooling;
+                size_t rank = 0;
+                for (auto const &[track, occurrences] : index)
+                {
+                    ready.push({occurrences.size(), rank++, occurrences.begin()});
+                }
+
+                for (size_t step = 0; step < sequence.size(); ++step)
+                {
+                    while (!cooling.empty() && cooling.front().first <= step)
+                    {
+                        ready.push(cooling.front().second);
+                        cooling.pop_front();
+                    }
+                    if (ready.empty())
+                    {
+                        return order;
+                    }
+
+                    Pending top = ready.top();
+                    ready.pop();
+                    order.push_back(*top.next);
+                    ++top.next;
+                    if (--top.remaining > 0)
+                    {
+                        cooling.emplace_back(step + spacing + 1, top);
+                    }
+                }
+                return order;
+            }
+
+            // Copies the entries of src for which skip(entry) is false into
+            // this empty Impl. Index nodes are created in sorted order at the
+            // end of the map and found again by the address of the source
+            // node, so tracks are copied once and never looked up by key.
+            // O(n log d) pointer comparisons.
+            // Returns the copy of *mark, or sequence.end() if there is none.
+            template <typename Skip>
+            SequenceIterator copy_from(Impl const &src, Skip skip,
+                ConstSequenceIterator const *mark = nullptr)
+            {
+                CXX_PLAYLIST_COUNT(deep_copies, 1);
+#ifdef CXX_PLAYLIST_CHECKED_ITERATORS
+                labelling = src.labelling;
+#endif
+                using Copy = std::pair<void const *, IndexIterator>;
+                auto by_source = [](Copy const &a, void const *b)
+                {
+                    return std::less<void const *>()(a.first, b);
+                };
+
+                prepare_table();
+                std::vector<Copy> copies;
+                copies.reserve(src.index.size());
+                for (auto const &node : src.index)
+                {
+                    auto copy = index.emplace_hint(
+                        index.end(), node.first, OccurrencesList{});
+                    index_added(copy);
+                    copies.emplace_back(&node, copy);
+                }
+                std::sort(copies.begin(), copies.end(),
+                    [&](Copy const &a, Copy const &b)
+                    { return by_source(a, b.first); });
+
+                SequenceIterator marked = sequence.end();
+                for (auto it = src.sequence.begin(); it != src.sequence.end(); ++it)
+                {
+                    if (skip(*it))
+                        continue;
+                    CXX_PLAYLIST_COUNT(entries_copied, 1);
+                    IndexIterator target = std::lower_bound(copies.begin(),
+                        copies.end(), &*it->map_it, by_source)->second;
+                    target->second.push_back(sequence.end());
+                    auto occurrence_it = std::prev(target->second.end());
+                    sequence.emplace_back(it->params, target, occurrence_it);
+                    sequence.back().order = it->order;
+                    sequence.back().id = it->id;
+                    *occurrence_it = std::prev(sequence.end());
+                    if (mark && it == *mark)
+                        marked = *occurrence_it;
+                }
+
+                // Tracks whose all entries were skipped.
+                for (auto it = index.begin(); it != index.end();)
+                {
+                    auto current = it++;
+                    if (current->second.empty())
+                        index_erase(current);
+                }
+                return marked;
+            }
+
+            // Fills this empty Impl with the entries of a and b, merging
+            // their play orders: an entry of b goes before the entries of a
+            // it is less than (a stable merge). The index is built in one
+            // pass over both sorted indexes, each track added at the end of
+            // the map; entries then find their index node by the address of
+            // the source node, as in copy_from. Entries are new entries,
+            // with new ids and evenly spaced labels.
+            // O(d_a + d_b) comparisons of tracks, O(n log d) of pointers.
+            template <typename Less>
+            void merge_from(Impl const &a, Impl const &b, Less less)
+            {
+                CXX_PLAYLIST_COUNT(deep_copies, 1);
+                using Copy = std::pair<void const *, IndexIterator>;
+                auto by_source = [](Copy const &x, void const *y)
+                {
+                    return std::less<void const *>()(x.first, y);
+                };
+
+                prepare_table();
+                std::vector<Copy> from_a, from_b;
+                from_a.reserve(a.index.size());
+                from_b.reserve(b.index.size());
+                auto ia = a.index.begin();
+                auto ib = b.index.begin();
+                while (ia != a.index.end() || ib != b.index.end())
+                {
+                    bool take_a = ia != a.index.end() &&
+                        (ib == b.index.end() || !(ib->first < ia->first));
+                    bool take_b = ib != b.index.end() &&
+                        (ia == a.index.end() || !(ia->first < ib->first));
+                    auto copy = index.emplace_hint(index.end(),
+                        take_a ? ia->first : ib->first, OccurrencesList{});
+                    index_added(copy);
+                    if (take_a)
+                        from_a.emplace_back(&*ia++, copy);
+                    if (take_b)
+                        from_b.emplace_back(&*ib++, copy);
+                }
+                for (auto *copies : {&from_a, &from_b})
+                {
+                    std::sort(copies->begin(), copies->end(),
+                        [&](Copy const &x, Copy const &y)
+                        { return by_source(x, y.first); });
+                }
+
+                std::uint64_t label = 0;
+                auto append = [&](Entry const &e, std::vector<Copy> const &copies)
+                {
+                    CXX_PLAYLIST_COUNT(entries_copied, 1);
+                    IndexIterator target = std::lower_bound(copies.begin(),
+                        copies.end(), &*e.map_it, by_source)->second;
+                    target->second.push_back(sequence.end());
+                    auto occurrence_it = std::prev(target->second.end());
+                    sequence.emplace_back(e.params, target, occurrence_it);
+                    label += label_step;
+                    sequence.back().order = label;
+                    sequence.back().id = next_id();
+                    *occurrence_it = std::prev(sequence.end());
+                };
+
+                auto ea = a.sequence.begin();
+                auto eb = b.sequence.begin();
+                while (ea != a.sequence.end() && eb != b.sequence.end())
+                {
+                    if (less(*eb, *ea))
+                        append(*eb++, from_b);
+                    else
+                        append(*ea++, from_a);
+                }
+                for (; ea != a.sequence.end(); ++ea)
+                    append(*ea, from_a);
+                for (; eb != b.sequence.end(); ++eb)
+                    append(*eb, from_b);
+            }
+
+            // Moves all entries of other to the end of this sequence without
+            // copying or allocating anything: the sequence nodes are spliced,
+            // index nodes of new tracks are moved over and occurrence lists of
+            // common tracks are spliced. Requires compare_nothrow.
+            // O(d log d) comparisons and O(n) back-link updates, where d and
+            // n are the distinct tracks and entries of other.
+            void splice_from(Impl &other) noexcept
+            {
+                if (other.sequence.empty())
+                    return;
+                invalidate();
+                drop_ids();
+                other.invalidate();
+                other.drop_flat();
+                other.drop_ids();
+
+                // Labels of other are shifted past the last label here.
+                std::uint64_t first = label_before(sequence.end());
+                std::uint64_t span =
+                    other.sequence.back().order - other.sequence.front().order;
+                std::uint64_t shift = first - other.sequence.front().order;
+                for (auto it = other.index.begin(); it != other.index.end();)
+                {
+                    auto source = it++;
+                    auto moved = source->second.begin();
+                    CXX_PLAYLIST_COUNT(index_lookups, 1);
+                    auto target = locate(source->first);
+                    if (target != index.end() &&
+                        !(source->first < target->first))
+                    {
+                        target->second.splice(target->second.end(),
+                            source->second);
+                        other.index.erase(source);
+                    }
+                    else
+                    {
+                        target = index.insert(target,
+                            other.index.extract(source));
+                        index_added(target);
+                    }
+
+                    for (; moved != target->second.end(); ++moved)
+                    {
+                        (*moved)->map_it = target;
+                        (*moved)->order += shift;
+                    }
+                }
+                sequence.splice(sequence.end(), other.sequence);
+                other.clear_table();
+                if (span > UINT64_MAX - first)
+                    relabel();
+            }
+
+            // Unlinks an entry from the sequence and from its occurrence
+            // list, dropping the index node when it was the last occurrence.
+            void erase_entry(ConstSequenceIterator it) noexcept
+            {
+                invalidate();
+                entries_unlinked();
+                note_unlinked_entry(it);
+                IndexIterator map_it = it->map_it;
+                map_it->second.erase(it->distinct_it);
+                if (map_it->second.empty())
+                {
+                    index_erase(map_it);
+                }
+                sequence.erase(it);
+            }
         };
 
         std::shared_ptr<Impl> data_;
         std::shared_ptr<Impl> safeguard_;
 
+        // Maximal number of entries, 0 if the playlist is unbounded.
+        size_t capacity_ = 0;
+
+        // Tracks fetched ahead by for_each_sorted().
+        static constexpr size_t sorted_prefetch_distance = 16;
+
+        // Allocates empty data (Impl and its control block in one pooled block).
+        static std::shared_ptr<Impl> make_impl()
+        {
+            return std::allocate_shared<Impl>(node_allocator<Impl, DataNodes>());
+        }
+
+        // Copies the current data without the entries matching skip. Only
+        // the entries that survive the operation are duplicated.
+        template <typename Skip>
+        std::shared_ptr<Impl> copy_data(Skip skip) const
+        {
+            auto new_data = make_impl();
+            new_data->copy_from(*data_, skip);
+            return new_data;
+        }
+
+        std::shared_ptr<Impl> copy_data() const
+        {
+            return copy_data([](Entry const &) { return false; });
+        }
+
         // Allows to manage copy on write or allocation
         // of *data_ if such does not exist.
         // This is also exception safe, as shared pointers have destructors.
@@ -115,16 +1257,11 @@ namespace cxx
         {
             if (!data_)
             {
-                data_ = std::make_shared<Impl>();
+                data_ = make_impl();
             }
             else if (data_.use_count() > 1)
             {
-                auto new_data = std::make_shared<Impl>();
-                for (auto const &entry : data_->sequence)
-                {
-                    new_data->insert_track(entry.map_it->first, entry.params);
-                }
-                data_ = std::move(new_data);
+                data_ = copy_data();
             }
         }
 
@@ -133,15 +1270,11 @@ namespace cxx
         {
             if (!data_)
             {
-                data_ = std::make_shared<Impl>();
+                data_ = make_impl();
             }
             else if (data_.use_count() > 1)
             {
-                auto new_data = std::make_shared<Impl>();
-                for (auto const &entry : data_->sequence)
-                {
-                    new_data->insert_track(entry.map_it->first, entry.params);
-                }
+                auto new_data = copy_data();
                 safeguard_ = data_;
                 data_ = std::move(new_data);
             }
@@ -151,6 +1284,7 @@ namespace cxx
         {
             if(safeguard_ != nullptr)
             {
+                CXX_PLAYLIST_COUNT(rollbacks, 1);
                 data_ = safeguard_;
                 safeguard_.reset();
             }
@@ -162,10 +1296,49 @@ namespace cxx
             safeguard_.reset();
         }
 
+        // Stamp of the current data, 0 when there is none.
+        std::uint64_t generation() const noexcept
+        {
+#ifdef CXX_PLAYLIST_CHECKED_ITERATORS
+            return data_ ? data_->generation : 0;
+#else
+            return 0;
+#endif
+        }
+
+        // Throws if the iterator is stale (in checked mode).
+        template <typename Iterator>
+        void check([[maybe_unused]] Iterator const &it,
+            [[maybe_unused]] char const *what) const
+        {
+#ifdef CXX_PLAYLIST_CHECKED_ITERATORS
+            if (it.generation_ != generation())
+                throw std::invalid_argument(what);
+#endif
+        }
+
+        // Position hint of a play iterator, unknown outside checked mode.
+        template <typename Iterator>
+        static size_t position_of([[maybe_unused]] Iterator const &it) noexcept
+        {
+#ifdef CXX_PLAYLIST_CHECKED_ITERATORS
+            return it.position_;
+#else
+            return Iterator::unknown_position;
+#endif
+        }
+
     public:
+        // Identity of an entry: a number unique over all playlists of the
+        // type, given when the entry is added and kept by every copy of it.
+        // A recycled node of a full bounded playlist is a new entry.
+        using entry_id = std::uint64_t;
+
         // --- Iterators ---
 
-        // Play iterator is just a wrapper to the iterator of a list.
+        // Play iterator is just a wrapper to the iterator of a list. In
+        // checked mode it also remembers the stamps of the data, the label and
+        // id of its entry and, when known, its position in play order.
         class play_iterator
         {
         public:
@@ -173,7 +1346,7 @@ namespace cxx
             using value_type = std::pair<T const &, P const &>;
             using difference_type = std::ptrdiff_t;
             using pointer = void;
-            using reference = void;
+            using reference = value_type;
 
             play_iterator() = default;
 
@@ -190,33 +1363,80 @@ namespace cxx
             play_iterator &operator++()
             {
                 ++it_;
+                moved(1);
                 return *this;
             }
             play_iterator operator++(int)
             {
                 play_iterator temp = *this;
-                ++it_;
+                ++*this;
                 return temp;
             }
             play_iterator &operator--()
             {
                 --it_;
+                moved(-1);
                 return *this;
             }
             play_iterator operator--(int)
             {
                 play_iterator temp = *this;
-                --it_;
+                --*this;
                 return temp;
             }
 
+            // Same as playlist::play(*this).
+            reference operator*() const
+            {
+                return reference(it_->map_it->first, it_->params);
+            }
+
         private:
             friend class playlist;
+            static constexpr size_t unknown_position = static_cast<size_t>(-1);
+
             ConstSequenceIterator it_;
-            explicit play_iterator(ConstSequenceIterator it) : it_(it) {}
+#ifdef CXX_PLAYLIST_CHECKED_ITERATORS
+            static constexpr std::uint64_t end_label = UINT64_MAX;
+
+            Impl const *owner_ = nullptr;
+            std::uint64_t generation_ = 0;
+            std::uint64_t labelling_ = 0;
+            std::uint64_t label_ = end_label;
+            std::uint64_t id_ = 0;
+            size_t position_ = unknown_position;
+#endif
+
+            play_iterator(ConstSequenceIterator it,
+                [[maybe_unused]] Impl const &owner,
+                [[maybe_unused]] size_t position) noexcept
+                : it_(it)
+            {
+#ifdef CXX_PLAYLIST_CHECKED_ITERATORS
+                owner_ = &owner;
+                generation_ = owner.generation;
+                position_ = position;
+                moved(0);
+#endif
+            }
+
+            // Follows a step of the underlying iterator (in checked mode).
+            void moved([[maybe_unused]] std::ptrdiff_t step) noexcept
+            {
+#ifdef CXX_PLAYLIST_CHECKED_ITERATORS
+                if (position_ != unknown_position)
+                    position_ += static_cast<size_t>(step);
+                labelling_ = owner_->labelling;
+                bool end = it_ == owner_->sequence.end();
+                label_ = end ? end_label : it_->order;
+                id_ = end ? 0 : it_->id;
+#endif
+            }
         };
 
-        // Sorted iterator is just a wrapper to the iterator of a map.
+        // Sorted iterator is just a wrapper to the iterator of a map. In
+        // checked mode it also remembers the stamp of the data and owns a
+        // copy of its track, so making or moving it copies the track.
         class sorted_iterator
         {
         public:
@@ -233,72 +1453,411 @@ namespace cxx
                 return it_ == other.it_;
             }
 
-            bool operator!=(sorted_iterator const &other) const
+            bool operator!=(sorted_iterator const &other) const
+            {
+                return it_ != other.it_;
+            }
+
+            sorted_iterator &operator++()
+            {
+                ++it_;
+                moved();
+                return *this;
+            }
+            sorted_iterator operator++(int)
+            {
+                sorted_iterator temp = *this;
+                ++*this;
+                return temp;
+            }
+            sorted_iterator &operator--()
+            {
+                --it_;
+                moved();
+                return *this;
+            }
+            sorted_iterator operator--(int)
+            {
+                sorted_iterator temp = *this;
+                --*this;
+                return temp;
+            }
+
+            T const &operator*() const
+            {
+                return it_->first;
+            }
+
+            T const *operator->() const
+            {
+                return &(it_->first);
+            }
+
+        private:
+            friend class playlist;
+            ConstIndexIterator it_;
+#ifdef CXX_PLAYLIST_CHECKED_ITERATORS
+            Impl const *owner_ = nullptr;
+            std::uint64_t generation_ = 0;
+            std::optional<T> track_; // empty at the end
+
+            static constexpr bool nothrow_make =
+                std::is_nothrow_copy_constructible_v<T>;
+#else
+            static constexpr bool nothrow_make = true;
+#endif
+
+            sorted_iterator(ConstIndexIterator it,
+                [[maybe_unused]] Impl const &owner) noexcept(nothrow_make)
+                : it_(it)
+            {
+#ifdef CXX_PLAYLIST_CHECKED_ITERATORS
+                owner_ = &owner;
+                generation_ = owner.generation;
+                moved();
+#endif
+            }
+
+            // Follows a step of the underlying iterator (in checked mode).
+            void moved() noexcept(nothrow_make)
+            {
+#ifdef CXX_PLAYLIST_CHECKED_ITERATORS
+                if (it_ == owner_->index.end())
+                    track_.reset();
+                else
+                    track_.emplace(it_->first);
+#endif
+            }
+        };
+
+        // Range visiting every entry exactly once in a pseudo-random order.
+        // The order is a bijection over positions (a Feistel network with
+        // cycle walking) keyed by a seed, so the range holds O(const) state
+        // and resolves positions through the random access layer of the data.
+        // It is invalidated by any modification of the playlist.
+        class shuffled_range
+        {
+        public:
+            class iterator
+            {
+            public:
+                using iterator_category = std::forward_iterator_tag;
+                using value_type = std::pair<T const &, P const &>;
+                using difference_type = std::ptrdiff_t;
+                using pointer = void;
+                using reference = value_type;
+
+                iterator() = default;
+
+                bool operator==(iterator const &other) const
+                {
+                    return step_ == other.step_;
+                }
+
+                bool operator!=(iterator const &other) const
+                {
+                    return step_ != other.step_;
+                }
+
+                iterator &operator++()
+                {
+                    ++step_;
+                    return *this;
+                }
+                iterator operator++(int)
+                {
+                    iterator temp = *this;
+                    ++step_;
+                    return temp;
+                }
+
+                reference operator*() const
+                {
+                    // Entries are scattered in memory, fetch one ahead early.
+                    if (step_ + prefetch_distance < range_->size_)
+                    {
+                        __builtin_prefetch(
+                            &range_->entry(step_ + prefetch_distance));
+                    }
+                    Entry const &e = range_->entry(step_);
+                    return reference(e.map_it->first, e.params);
+                }
+
+            private:
+                friend class shuffled_range;
+                shuffled_range const *range_ = nullptr;
+                size_t step_ = 0;
+                iterator(shuffled_range const *range, size_t step)
+                    : range_(range), step_(step) {}
+            };
+
+            iterator begin() const noexcept
+            {
+                return iterator(this, 0);
+            }
+
+            iterator end() const noexcept
+            {
+                return iterator(this, size_);
+            }
+
+            size_t size() const noexcept
+            {
+                return size_;
+            }
+
+        private:
+            friend class playlist;
+            static constexpr int rounds = 4;
+            static constexpr size_t prefetch_distance = 8;
+
+            ConstSequenceIterator const *positions_ = nullptr;
+            size_t size_ = 0;
+            int half_bits_ = 1;
+            std::uint64_t keys_[rounds] = {};
+
+            shuffled_range(std::vector<ConstSequenceIterator> const &positions,
+                std::uint64_t seed)
+                : positions_(positions.data()), size_(positions.size())
+            {
+                int bits = size_ > 1 ? std::bit_width(size_ - 1) : 1;
+                half_bits_ = (bits + 1) / 2;
+                for (int r = 0; r < rounds; ++r)
+                {
+                    seed = mix(seed);
+                    keys_[r] = seed;
+                }
+            }
+
+            // SplitMix64 finaliser.
+            static std::uint64_t mix(std::uint64_t x) noexcept
+            {
+                x += 0x9e3779b97f4a7c15ULL;
+                x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+                x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+                return x ^ (x >> 31);
+            }
+
+            // Permutation of [0, 4^half_bits_).
+            std::uint64_t encrypt(std::uint64_t x) const noexcept
+            {
+                std::uint64_t mask = (std::uint64_t{1} << half_bits_) - 1;
+                std::uint64_t left = x >> half_bits_;
+                std::uint64_t right = x & mask;
+                for (int r = 0; r < rounds; ++r)
+                {
+                    std::uint64_t next = left ^ (mix(right ^ keys_[r]) & mask);
+                    left = right;
+                    right = next;
+                }
+                return (left << half_bits_) | right;
+            }
+
+            Entry const &entry(size_t step) const noexcept
+            {
+                return *positions_[permute(step)];
+            }
+
+            // Restriction of the permutation to [0, size_). The domain is
+            // less than 4 * size_, so few steps are expected.
+            size_t permute(size_t step) const noexcept
+            {
+                std::uint64_t x = encrypt(step);
+                while (x >= size_)
+                {
+                    x = encrypt(x);
+                }
+                return static_cast<size_t>(x);
+            }
+        };
+
+        // Range over the tracks in sorted order with their numbers of
+        // occurrences, backed by the flat index of the data. It is
+        // invalidated by any modification of the playlist.
+        class sorted_range
+        {
+        public:
+            class iterator
+            {
+            public:
+                using iterator_category = std::forward_iterator_tag;
+                using value_type = std::pair<T const &, size_t>;
+                using difference_type = std::ptrdiff_t;
+                using pointer = void;
+                using reference = value_type;
+
+                iterator() = default;
+
+                bool operator==(iterator const &other) const
+                {
+                    return entry_ == other.entry_;
+                }
+
+                bool operator!=(iterator const &other) const
+                {
+                    return entry_ != other.entry_;
+                }
+
+                iterator &operator++()
+                {
+                    ++entry_;
+                    return *this;
+                }
+                iterator operator++(int)
+                {
+                    iterator temp = *this;
+                    ++entry_;
+                    return temp;
+                }
+
+                reference operator*() const
+                {
+                    return reference(entry_->node->first,
+                        entry_->node->second.size());
+                }
+
+            private:
+                friend class sorted_range;
+                FlatEntry const *entry_ = nullptr;
+                explicit iterator(FlatEntry const *entry) : entry_(entry) {}
+            };
+
+            iterator begin() const noexcept
+            {
+                return iterator(entries_);
+            }
+
+            iterator end() const noexcept
             {
-                return it_ != other.it_;
+                return iterator(entries_ + size_);
             }
 
-            sorted_iterator &operator++()
+            size_t size() const noexcept
             {
-                ++it_;
-                return *this;
+                return size_;
             }
-            sorted_iterator operator++(int)
+
+        private:
+            friend class playlist;
+            FlatEntry const *entries_ = nullptr;
+            size_t size_ = 0;
+
+            sorted_range() noexcept = default;
+            explicit sorted_range(std::vector<FlatEntry> const &entries) noexcept
+                : entries_(entries.data()), size_(entries.size()) {}
+        };
+
+        // Input range over the params in play order, in batches of up to a
+        // given number of consecutive entries. Entries live in separate
+        // nodes, so each batch is copied into a buffer owned by the range and
+        // seen as a contiguous span, which the next batch overwrites. It is
+        // invalidated by any modification of the playlist.
+        class batch_range
+        {
+        public:
+            class iterator
             {
-                sorted_iterator temp = *this;
-                ++it_;
-                return temp;
-            }
-            sorted_iterator &operator--()
+            public:
+                using iterator_concept = std::input_iterator_tag;
+                using value_type = std::span<P const>;
+                using difference_type = std::ptrdiff_t;
+
+                iterator() = default;
+
+                bool operator==(std::default_sentinel_t) const noexcept
+                {
+                    return range_->buffer_.empty();
+                }
+
+                iterator &operator++()
+                {
+                    range_->fill();
+                    return *this;
+                }
+                void operator++(int)
+                {
+                    range_->fill();
+                }
+
+                value_type operator*() const noexcept
+                {
+                    return value_type(range_->buffer_);
+                }
+
+            private:
+                friend class batch_range;
+                batch_range *range_ = nullptr;
+                explicit iterator(batch_range *range) : range_(range) {}
+            };
+
+            // Gathers the first batch; may be called once.
+            iterator begin()
             {
-                --it_;
-                return *this;
+                fill();
+                return iterator(this);
             }
-            sorted_iterator operator--(int)
+
+            std::default_sentinel_t end() const noexcept
             {
-                sorted_iterator temp = *this;
-                --it_;
-                return temp;
+                return {};
             }
 
-            T const &operator*() const
+        private:
+            friend class playlist;
+            ConstSequenceIterator next_;
+            ConstSequenceIterator end_;
+            size_t batch_;
+            std::vector<P> buffer_;
+
+            batch_range(ConstSequenceIterator first, ConstSequenceIterator last,
+                size_t batch)
+                : next_(first), end_(last), batch_(batch)
             {
-                return it_->first;
+                buffer_.reserve(batch);
             }
 
-            T const *operator->() const
+            void fill()
             {
-                return &(it_->first);
+                buffer_.clear();
+                for (; next_ != end_ && buffer_.size() < batch_; ++next_)
+                {
+                    buffer_.push_back(next_->params);
+                }
             }
-
-        private:
-            friend class playlist;
-            ConstIndexIterator it_;
-            explicit sorted_iterator(ConstIndexIterator it) : it_(it) {}
         };
 
         // --- Constructors & Destructor ---
 
-        playlist() : data_(std::make_shared<Impl>()) {}
+        // The data is allocated by the first modification, so empty
+        // playlists cost no allocation.
+        playlist() noexcept = default;
 
-        playlist(playlist const &other) : data_(other.data_)
+        // Creates a bounded playlist: once it holds capacity entries, every
+        // push_back drops the oldest one. Capacity 0 means unbounded.
+        explicit playlist(size_t capacity) noexcept : capacity_(capacity) {}
+
+        playlist(playlist const &other)
+            : data_(other.data_), capacity_(other.capacity_)
         {
             if(other.forceCopy) detach();
         }
 
-        playlist(playlist &&other) : data_(std::move(other.data_)) {}
+        playlist(playlist &&other)
+            : data_(std::move(other.data_)), capacity_(other.capacity_) {}
 
         ~playlist() noexcept = default;
 
         playlist &operator=(playlist other)
         {
             std::swap(data_, other.data_);
+            std::swap(capacity_, other.capacity_);
             return *this;
         }
 
         // --- Non Const Methods ---
 
-        // Adds track and parameters at the end.
+        // Adds track and parameters at the end. A full bounded playlist
+        // drops its first element, reusing its nodes when possible.
         // O(log n)
         void push_back(T const &track, P const &params)
         {
@@ -306,7 +1865,10 @@ namespace cxx
 
             try
             {
-                data_->insert_track(track, params);
+                if (capacity_ != 0 && data_->sequence.size() >= capacity_)
+                    data_->replace_front(track, params);
+                else
+                    data_->insert_track(track, params);
             }
             catch (...)
             {
@@ -317,7 +1879,8 @@ namespace cxx
         }
 
         // Removes first element from the playlist.
-        // O(const)
+        // O(const), O(n) when the data is shared (the first entry is not
+        // copied at all).
         void pop_front()
         {
             // Handle special cases.
@@ -325,26 +1888,195 @@ namespace cxx
             {
                 throw std::out_of_range("pop_front, playlist empty");
             }
+
+            if (data_.use_count() > 1)
+            {
+                Entry const *first = &data_->sequence.front();
+                data_ = copy_data(
+                    [first](Entry const &e) { return &e == first; });
+            }
+            else
+            {
+                data_->erase_entry(data_->sequence.begin());
+            }
+            finalizeDetach();
+        }
+
+        // Adds all {track, params} pairs of the range at the end, with at most
+        // one detach for the whole batch. Either all elements are added or,
+        // on exception, the playlist is left unchanged (for a bounded
+        // playlist the elements added so far are kept).
+        // O(k log n)
+        template <typename Range>
+        void append_range(Range &&range)
+        {
+            if (capacity_ != 0)
+            {
+                for (auto &&item : range)
+                {
+                    auto const &[track, params] = item;
+                    push_back(track, params);
+                }
+                return;
+            }
+
             guardedDetach();
 
+            size_t added = 0;
             try
             {
-                auto it = data_->sequence.begin();
-                it->map_it->second.erase(it->distinct_it);
-
-                if (it->map_it->second.empty())
+                for (auto &&item : range)
                 {
-                    data_->index.erase(it->map_it);
+                    auto const &[track, params] = item;
+                    data_->insert_track(track, params);
+                    ++added;
                 }
-                data_->sequence.pop_front();
             }
             catch (...)
             {
-                reverseDetach();
+                if (safeguard_)
+                {
+                    reverseDetach();
+                }
+                else
+                {
+                    CXX_PLAYLIST_COUNT(rollbacks, 1);
+                    for (; added > 0; --added)
+                    {
+                        data_->erase_entry(std::prev(data_->sequence.end()));
+                    }
+                }
                 throw;
             }
+            finalizeDetach();
+        }
+
+        // Appends all entries of other and leaves it empty. No entry is
+        // copied unless other shares its data, this playlist is bounded or
+        // comparing tracks may throw: the sequence nodes are spliced and the
+        // indexes merged track by track. On exception neither playlist is
+        // changed.
+        // O(const) when this playlist is empty, O(d log n + k) otherwise,
+        // where d and k are the distinct tracks and entries of other.
+        void append(playlist &&other)
+        {
+            if (&other == this)
+            {
+                append(std::as_const(other));
+                return;
+            }
+            if (!other.data_)
+                return;
+
+            if (capacity_ != 0 || !Impl::compare_nothrow)
+            {
+                append(std::as_const(other));
+            }
+            else if (!data_ || data_->sequence.empty())
+            {
+                data_ = std::move(other.data_);
+            }
+            else if (other.data_.use_count() > 1)
+            {
+                append(std::as_const(other));
+            }
+            else
+            {
+                detach();
+                data_->splice_from(*other.data_);
+            }
+            other.data_.reset();
+            finalizeDetach();
+        }
+
+        // Appends copies of all entries of other, which may be this playlist.
+        // Gives the same guarantees as append_range.
+        // O(k log n)
+        void append(playlist const &other)
+        {
+            if (!other.data_)
+                return;
+
+            // Holding the source also makes appending a playlist to itself
+            // copy the data first instead of walking the growing sequence.
+            auto source = other.data_;
+            append_range(source->sequence | std::views::transform(
+                [](Entry const &e)
+                {
+                    return std::pair<T const &, P const &>(
+                        e.map_it->first, e.params);
+                }));
+        }
+
+        // Adds track and parameters before the entry under pos, or at the end
+        // for play_end(). A full bounded playlist drops its first entry, like
+        // push_back. Returns an iterator to the new entry (to the first entry
+        // if the new one was dropped at once). If the data is shared, the copy
+        // locates the counterpart of pos on the way.
+        // O(log d + min(i, k - i)) for the i-th of k occurrences of the track,
+        // O(n) when the data is shared or the labels have to be renumbered.
+        play_iterator insert(play_iterator const &pos,
+            T const &track, P const &params)
+        {
+            check(pos, "insert, stale iterator");
+            std::shared_ptr<Impl> new_data;
+            ConstSequenceIterator where = pos.it_;
+            if (!data_)
+            {
+                new_data = make_impl();
+                where = new_data->sequence.end();
+            }
+            else if (data_.use_count() > 1)
+            {
+                new_data = make_impl();
+                where = new_data->copy_from(
+                    *data_, [](Entry const &) { return false; }, &pos.it_);
+            }
+
+            Impl &target = new_data ? *new_data : *data_;
+            auto it = target.insert_before(where, track, params);
+            size_t position = position_of(pos);
+            if (capacity_ != 0 && target.sequence.size() > capacity_)
+            {
+                bool dropped = it == target.sequence.begin();
+                target.erase_entry(target.sequence.begin());
+                if (dropped)
+                    it = target.sequence.begin();
+                position = dropped ? 0 : play_iterator::unknown_position;
+            }
+            if (new_data)
+                data_ = std::move(new_data);
+            finalizeDetach();
+            return play_iterator(it, target, position);
+        }
+
+        // Removes the entry under the iterator. Returns an iterator to the
+        // entry that followed it.
+        // O(const), O(n) when the data is shared (the erased entry is not
+        // copied at all).
+        play_iterator erase(play_iterator const &it)
+        {
+            check(it, "erase, stale iterator");
+            if (!data_ || it.it_ == data_->sequence.end())
+            {
+                throw std::out_of_range("erase, no entry under the iterator");
+            }
 
+            auto next = std::next(it.it_);
+            if (data_.use_count() > 1)
+            {
+                Entry const *erased = &*it.it_;
+                auto new_data = make_impl();
+                next = new_data->copy_from(*data_,
+                    [erased](Entry const &e) { return &e == erased; }, &next);
+                data_ = std::move(new_data);
+            }
+            else
+            {
+                data_->erase_entry(it.it_);
+            }
             finalizeDetach();
+            return play_iterator(next, *data_, position_of(it));
         }
 
         // Removes all occurences of a track from the playlist.
@@ -356,27 +2088,30 @@ namespace cxx
             {
                 throw std::invalid_argument("remove, unknown track");
             }
-            auto it = data_->index.find(track);
+            CXX_PLAYLIST_COUNT(index_lookups, 1);
+            auto it = data_->find(track);
             if (it == data_->index.end())
             {
                 throw std::invalid_argument("remove, unknown track");
             }
-            guardedDetach();
 
-            try
+            if (data_.use_count() > 1)
+            {
+                // Copy only the entries of the other tracks.
+                auto removed = &*it;
+                data_ = copy_data(
+                    [removed](Entry const &e) { return &*e.map_it == removed; });
+            }
+            else
             {
-                // Find again after detach and remove.
-                auto map_it = data_->index.find(track);
-                for (auto seq_it : map_it->second)
+                data_->invalidate();
+                data_->entries_unlinked();
+                data_->drop_ids();
+                for (auto seq_it : it->second)
                 {
                     data_->sequence.erase(seq_it);
                 }
-                data_->index.erase(map_it);
-            }
-            catch (...)
-            {
-                reverseDetach();
-                throw;
+                data_->index_erase(it);
             }
 
             finalizeDetach();
@@ -393,37 +2128,60 @@ namespace cxx
             }
             else if (data_)
             {
-                data_->sequence.clear();
-                data_->index.clear();
+                data_->clear();
             }
-            else
+        }
+
+        // Reorders the playlist so that two occurrences of the same track are
+        // separated by at least spacing other entries, keeping the order of
+        // occurrences within each track. Throws if no such order exists.
+        // O(n log d)
+        void respace(size_t spacing)
+        {
+            if (!data_ || spacing == 0)
+                return;
+            guardedDetach();
+
+            std::vector<ConstSequenceIterator> order;
+            try
+            {
+                order = data_->spread(spacing);
+            }
+            catch (...)
             {
-                data_ = std::make_shared<Impl>();
+                reverseDetach();
+                throw;
+            }
+            if (order.size() != data_->sequence.size())
+            {
+                reverseDetach();
+                throw std::invalid_argument("respace, spacing impossible");
+            }
+
+            data_->invalidate();
+            for (auto it : order)
+            {
+                data_->sequence.splice(data_->sequence.end(), data_->sequence, it);
             }
+            data_->relabel();
+            finalizeDetach();
         }
 
         // Reads parameters of a given iterator.
-        // O(const)
-        // In the case of detaching here additional O(n) distance computation is
-        // performed (overshadowed by O(n log n) deep copy.
+        // O(const), O(n) when the data is shared and has to be copied.
         P &params(play_iterator const &it)
         {
+            check(it, "params, stale iterator");
             forceCopy = true;
             if (data_ && data_.use_count() > 1)
             {
                 // If data is shared, a detach is needed, as the user is provided
-                // with means to change the data.
-                // After that to find the equivalent of the iterator in new
-                // data, the safe way is to do it is by computing the distance
-                // from the beginning.
-                auto old_begin = data_->sequence.begin();
-                auto dist = std::distance(
-                    ConstSequenceIterator(old_begin), it.it_);
-                detach();
-
-                auto new_it = data_->sequence.begin();
-                std::advance(new_it, dist);
-
+                // with means to change the data. The copy locates the
+                // equivalent of the iterator on the way.
+                auto new_data = make_impl();
+                auto new_it = new_data->copy_from(
+                    *data_, [](Entry const &) { return false; }, &it.it_);
+                data_ = std::move(new_data);
                 return new_it->params;
             }
 
@@ -432,6 +2190,29 @@ namespace cxx
             return e.params;
         }
 
+        // Modifies the parameters under the iterator by calling fn(P &).
+        // Unlike the non-const params(), no reference escapes, so copies made
+        // later keep sharing the data. If the data is shared it is copied once
+        // and, should fn throw, the copy is dropped and the playlist is left
+        // unchanged; otherwise fn works in place.
+        // O(const), O(n) when the data is shared.
+        template <typename F>
+        void update_params(play_iterator const &it, F &&fn)
+        {
+            check(it, "update_params, stale iterator");
+            if (data_ && data_.use_count() > 1)
+            {
+                auto new_data = make_impl();
+                auto new_it = new_data->copy_from(
+                    *data_, [](Entry const &) { return false; }, &it.it_);
+                std::forward<F>(fn)(new_it->params);
+                data_ = std::move(new_data);
+                return;
+            }
+
+            std::forward<F>(fn)(it.it_->params);
+        }
+
         // --- Constant Getters (O(const) ---
 
         // Gets the first element of the queue as <T, P> pair.
@@ -468,6 +2249,172 @@ namespace cxx
             return e.params;
         }
 
+        // Gets the identity of the entry under the iterator.
+        // O(const)
+        entry_id id(play_iterator const &it) const noexcept
+        {
+            return it.it_->id;
+        }
+
+        // Finds the entry with the identity, play_end() if there is none.
+        // Works on every copy holding the entry, whatever else was changed
+        // since, so the identity can be kept instead of an iterator.
+        // O(log n), O(n log n) on first use after a copy, a track removal or
+        // the erasure of half of the entries.
+        play_iterator find(entry_id entry) const
+        {
+            if (!data_)
+                return play_iterator();
+            return play_iterator(data_->find_entry(entry), *data_,
+                play_iterator::unknown_position);
+        }
+
+        // Gets a range over all entries in a pseudo-random order determined
+        // by the seed.
+        // O(n) on first use after a modification, O(const) afterwards.
+        shuffled_range shuffle_view(std::uint64_t seed) const
+        {
+            static std::vector<ConstSequenceIterator> const none;
+            if (!data_)
+                return shuffled_range(none, seed);
+            return shuffled_range(data_->random_access(), seed);
+        }
+
+        // Gets the tracks in sorted order with their numbers of occurrences,
+        // like sorted_begin()/pay() but read from a contiguous array.
+        // O(d) on first use after a track was removed, O(m log m + d) after
+        // m new tracks were added, O(const) otherwise.
+        sorted_range sorted_index() const
+        {
+            if (!data_)
+                return sorted_range();
+            return sorted_range(data_->flat_index());
+        }
+
+        // Calls fn(track, number of occurrences) for every track in sorted
+        // order, like a walk over sorted_index(). The flat index knows the
+        // index nodes in advance, so the nodes a few tracks ahead are
+        // fetched early and the cache misses on them overlap, instead of
+        // following one another as in a walk of the tree, where each node is
+        // only found through the previous one.
+        // O(d), with the same upkeep as sorted_index().
+        template <typename F>
+        void for_each_sorted(F &&fn) const
+        {
+            if (!data_)
+                return;
+            auto const &flat = data_->flat_index();
+            size_t const tracks = flat.size();
+            for (size_t i = 0; i < tracks; ++i)
+            {
+                if (i + sorted_prefetch_distance < tracks)
+                {
+                    // The key and the size of the occurrence list may lie
+                    // in different cache lines of the node.
+                    auto node = flat[i + sorted_prefetch_distance].node;
+                    __builtin_prefetch(&node->first);
+                    __builtin_prefetch(&node->second);
+                }
+                auto node = flat[i].node;
+                std::invoke(fn, node->first, node->second.size());
+            }
+        }
+
+        // Gets the params in play order, in spans of up to batch entries
+        // copied out of the playlist (the last one may be shorter).
+        // O(batch) per batch.
+        batch_range batches(size_t batch) const
+        {
+            if (batch == 0)
+                throw std::invalid_argument("batches, batch size must be positive");
+            if (!data_)
+                return batch_range({}, {}, batch);
+            return batch_range(data_->sequence.begin(), data_->sequence.end(),
+                batch);
+        }
+
+        // Gets the number of occurrences of the track, 0 if it is absent.
+        // O(log d), with the same upkeep as sorted_index().
+        size_t count(T const &track) const
+        {
+            if (!data_)
+                return 0;
+            CXX_PLAYLIST_COUNT(index_lookups, 1);
+            if constexpr (direct_index)
+            {
+                auto it = data_->find(track);
+                return it == data_->index.end() ? 0 : it->second.size();
+            }
+            else
+            {
+                FlatEntry const *entry = data_->flat_find(track);
+                return entry ? entry->node->second.size() : 0;
+            }
+        }
+
+        // Gets the play order respace(spacing) would produce, without
+        // modifying the playlist. Throws if no such order exists.
+        // O(n log d)
+        std::vector<play_iterator> spread_view(size_t spacing) const
+        {
+            std::vector<play_iterator> result;
+            if (!data_)
+                return result;
+
+            auto order = data_->spread(spacing);
+            if (order.size() != data_->sequence.size())
+                throw std::invalid_argument("spread_view, spacing impossible");
+            result.reserve(order.size());
+            for (auto it : order)
+            {
+                result.push_back(play_iterator(
+                    it, *data_, play_iterator::unknown_position));
+            }
+            return result;
+        }
+
+        // Gets the memory occupied by the data of the playlist, split by
+        // structure and by whether copies share it. Not noexcept, as it takes
+        // the mutex of the lazy layers, whose lock() may throw
+        // std::system_error.
+        // O(const)
+        playlist_memory memory_usage() const
+        {
+            playlist_memory usage;
+            if (!data_)
+                return usage;
+
+            auto bytes = [](auto const &kind)
+            {
+                return kind.bytes.load(std::memory_order_relaxed);
+            };
+            size_t entries = data_->sequence.size();
+            usage.sequence_nodes = entries * bytes(SequenceNodes());
+            usage.occurrence_nodes = entries * bytes(OccurrenceNodes());
+            usage.index_nodes = data_->index.size() * bytes(IndexNodes());
+            // The lazy layers may be being built by a reader of a copy.
+            std::lock_guard<std::mutex> lock(data_->layers_mutex);
+            usage.other = bytes(DataNodes()) +
+                data_->positions.capacity() * sizeof(ConstSequenceIterator) +
+                (data_->flat.capacity() + data_->flat_delta.capacity()) *
+                    sizeof(FlatEntry) +
+                data_->by_id.capacity() * sizeof(data_->by_id[0]);
+            if constexpr (direct_index)
+                usage.other += data_->table.capacity() * sizeof(IndexIterator);
+            usage.owners = static_cast<size_t>(data_.use_count());
+            if (usage.owners > 1)
+                usage.shared = usage.total();
+            else
+                usage.exclusive = usage.total();
+            return usage;
+        }
+
+        // Gets the maximal number of entries, 0 if the playlist is unbounded.
+        size_t capacity() const noexcept
+        {
+            return capacity_;
+        }
+
         // Gets the size of the playlist.
         size_t size() const noexcept
         {
@@ -485,7 +2432,7 @@ namespace cxx
             if (!data_)
                 return play_iterator();
 
-            return play_iterator(data_->sequence.begin());
+            return play_iterator(data_->sequence.begin(), *data_, 0);
         }
 
         // Gets iterator to the last element on the playlist.
@@ -494,16 +2441,18 @@ namespace cxx
             if (!data_)
                 return play_iterator();
 
-            return play_iterator(data_->sequence.end());
+            return play_iterator(data_->sequence.end(), *data_,
+                data_->sequence.size());
         }
 
         // Gets iterator to the first element on the playlist in sorted order.
-        sorted_iterator sorted_begin() const noexcept
+        sorted_iterator sorted_begin() const
+            noexcept(sorted_iterator::nothrow_make)
         {
             if (!data_)
                 return sorted_iterator();
 
-            return sorted_iterator(data_->index.begin());
+            return sorted_iterator(data_->index.begin(), *data_);
         }
 
         // Gets iterator to the last element on the playlist in sorted order.
@@ -512,10 +2461,147 @@ namespace cxx
             if (!data_)
                 return sorted_iterator();
 
-            return sorted_iterator(data_->index.end());
+            return sorted_iterator(data_->index.end(), *data_);
+        }
+
+        // Gets the entries in play order as a bidirectional range.
+        std::ranges::subrange<play_iterator> play_view() const noexcept
+        {
+            return {play_begin(), play_end()};
+        }
+
+        // Gets the tracks in sorted order as a bidirectional range.
+        std::ranges::subrange<sorted_iterator> sorted_view() const
+            noexcept(sorted_iterator::nothrow_make)
+        {
+            return {sorted_begin(), sorted_end()};
+        }
+
+#ifdef CXX_PLAYLIST_CHECKED_ITERATORS
+        // --- Checked Iterators ---
+
+        // An iterator is stale once the data it was made from has been
+        // replaced by a copy (any modification of shared data, clear() or
+        // the non-const params()) or one of its entries has been unlinked
+        // in place (pop_front(), erase(), remove(), a full bounded
+        // playlist). Adding entries in place keeps iterators valid.
+        // insert(), erase(), params() and update_params() throw
+        // std::invalid_argument when given a stale iterator.
+
+        // Checks whether the iterator may still be used with this playlist.
+        // O(const)
+        bool valid(play_iterator const &it) const noexcept
+        {
+            return it.generation_ == generation();
+        }
+
+        bool valid(sorted_iterator const &it) const noexcept
+        {
+            return it.generation_ == generation();
+        }
+
+        // Gets a valid iterator to the entry the stale iterator was under,
+        // or to the entry that took its place if it is gone. Entries are
+        // found by their labels, which copies keep, and once the labels have
+        // been renumbered by their ids (see find()). An entry gone since the
+        // renumbering is replaced by the one at its position in play order,
+        // or by the end if the iterator did not know its position (as those
+        // from find() and spread_view()).
+        // O(const) when the entry kept its position, O(log n) otherwise,
+        // after the random access layer is rebuilt (O(n) on first use after
+        // a modification, like shuffle_view()).
+        play_iterator rebind(play_iterator const &it) const
+        {
+            if (valid(it))
+                return it;
+            if (!data_)
+                return play_iterator();
+
+            auto const &positions = data_->random_access();
+            auto at = [&](size_t position)
+            {
+                if (position >= positions.size())
+                    return play_end();
+                return play_iterator(positions[position], *data_, position);
+            };
+            auto by_label = [&](std::uint64_t label)
+            {
+                if (it.position_ < positions.size() &&
+                    positions[it.position_]->order == label)
+                {
+                    return at(it.position_);
+                }
+                auto found = std::lower_bound(positions.begin(),
+                    positions.end(), label,
+                    [](ConstSequenceIterator e, std::uint64_t key)
+                    { return e->order < key; });
+                return at(static_cast<size_t>(found - positions.begin()));
+            };
+            if (it.label_ == play_iterator::end_label)
+                return play_end();
+            if (it.labelling_ == data_->labelling)
+                return by_label(it.label_);
+            auto entry = data_->find_entry(it.id_);
+            if (entry != data_->sequence.end())
+                return by_label(entry->order);
+            return at(it.position_);
         }
+
+        // Gets a valid iterator to the track of the stale iterator, or to
+        // the next track in sorted order if it is gone.
+        // O(log d) after the flat index is brought up to date (see
+        // sorted_index()).
+        sorted_iterator rebind(sorted_iterator const &it) const
+        {
+            if (valid(it))
+                return it;
+            if (!data_)
+                return sorted_iterator();
+            if (!it.track_)
+                return sorted_end();
+
+            auto const &flat = data_->flat_index();
+            auto found = std::lower_bound(flat.begin(), flat.end(), *it.track_,
+                [](FlatEntry const &e, T const &t) { return e.track() < t; });
+            if (found == flat.end())
+                return sorted_end();
+            return sorted_iterator(found->node, *data_);
+        }
+#endif
     };
 
+    // Interleaves the play orders of a and b into a new, unbounded playlist,
+    // ordered by comp on proj(params), e.g. two stations' playlists by start
+    // time for a simulcast. It is a stable merge: each playlist keeps its
+    // own order, and on ties entries of a come first. Instead of adding the
+    // entries one by one, the combined index is built by merging the sorted
+    // indexes of a and b.
+    // O(d_a + d_b) comparisons of tracks, O(n) of projections and O(n log d)
+    // of pointers, where n is the number of entries of both.
+    template <typename T, typename P, typename Proj, typename Comp>
+    playlist<T, P> merge_interleaved(playlist<T, P> const &a,
+        playlist<T, P> const &b, Proj proj, Comp comp)
+    {
+        using Entry = typename playlist<T, P>::Entry;
+        playlist<T, P> result;
+        if (!a.data_ && !b.data_)
+            return result;
+
+        std::shared_ptr<typename playlist<T, P>::Impl> empty;
+        if (!a.data_ || !b.data_)
+            empty = playlist<T, P>::make_impl();
+        auto merged = playlist<T, P>::make_impl();
+        merged->merge_from(a.data_ ? *a.data_ : *empty,
+            b.data_ ? *b.data_ : *empty,
+            [&](Entry const &x, Entry const &y)
+            {
+                return std::invoke(comp, std::invoke(proj, x.params),
+                    std::invoke(proj, y.params));
+            });
+        result.data_ = std::move(merged);
+        return result;
+    }
+
 } // namespace cxx
 
 #endif // PLAYLIST_H
\ No newline at end of file
@@ -0,0 +1,935 @@
+// Benchmarks of playlist operations.
+// g++ -Wall -Wextra -O2 -std=c++23 playlist_bench.cpp -o playlist_bench.o
+// Add -DCXX_PLAYLIST_NODE_POOL to measure with the node pool.
+//
+// Usage: ./playlist_bench.o [max_size [filter]]
+//        ./playlist_bench.o memory [max_size]
+//   max_size  largest playlist of the core suite, which runs sizes 1e3,
+//             1e4, ... up to it (default 1000000, 10000000 for a full run)
+//   filter    runs only benchmarks whose name contains this text
+//
+// Results are printed as CSV:
+//   benchmark,type,n,ops,seconds,ns_per_op,allocs_per_op
+// The memory mode compares heap bytes per entry of the playlist with
+// alternative layouts holding the same data instead:
+//   layout,type,n,distinct,bytes_per_entry
+// To track regressions, build the benchmark against two revisions of
+// playlist.h and compare their outputs.
+
+#include "ingest_queue.h"
+#include "journaled_playlist.h"
+#include "playlist.h"
+#include "playlist_columns.h"
+#include "playlist_stream.h"
+#include "sharded_playlist.h"
+#include "undo_playlist.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <list>
+#include <malloc.h>
+#include <map>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Every allocation in this program is counted, so that benchmarks can
+// report allocations per operation next to the timings, and so are the
+// heap bytes in use (as reported by malloc_usable_size). The counters are
+// atomic for the benchmarks with several writer threads.
+namespace {
+  std::atomic<std::size_t> allocations{0};
+  std::atomic<std::size_t> live_bytes{0};
+}
+
+void *operator new(std::size_t size) {
+  ++allocations;
+  if (void *p = std::malloc(size == 0 ? 1 : size)) {
+    live_bytes += malloc_usable_size(p);
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept {
+  if (p)
+    live_bytes -= malloc_usable_size(p);
+  std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+  ::operator delete(p);
+}
+
+// Params with the same bytes as std::pair<unsigned, unsigned>, but not
+// trivially copyable, so the journal encodes them one by one.
+struct boxed_params {
+  unsigned first = 0, second = 0;
+  boxed_params() = default;
+  boxed_params(unsigned a, unsigned b) : first(a), second(b) {}
+  boxed_params(boxed_params const &other)
+      : first(other.first), second(other.second) {}
+  boxed_params &operator=(boxed_params const &) = default;
+};
+
+template <>
+struct cxx::journal_codec<boxed_params> {
+  static void encode(std::string &out, boxed_params const &x) {
+    journal_codec<unsigned>::encode(out, x.first);
+    journal_codec<unsigned>::encode(out, x.second);
+  }
+  static bool decode(std::string_view &in, boxed_params &x) {
+    std::string_view rest = in;
+    if (!journal_codec<unsigned>::decode(rest, x.first) ||
+        !journal_codec<unsigned>::decode(rest, x.second))
+      return false;
+    in = rest;
+    return true;
+  }
+};
+
+namespace {
+  using clock_type = std::chrono::steady_clock;
+
+  // Prevents the compiler from optimising away the measured work.
+  template <typename V>
+  void keep(V const &value) {
+    asm volatile("" : : "g"(&value) : "memory");
+  }
+
+  std::string_view filter;
+
+  // Measures work (ops operations on a playlist of size n) and prints
+  // one CSV row, unless the benchmark is filtered out.
+  template <typename F>
+  void run(std::string_view name, std::string_view type, std::size_t n,
+           std::size_t ops, F &&work) {
+    if (name.find(filter) == std::string_view::npos)
+      return;
+
+    std::size_t before = allocations;
+    auto start = clock_type::now();
+    work();
+    auto stop = clock_type::now();
+    double seconds = std::chrono::duration<double>(stop - start).count();
+    double count = static_cast<double>(ops == 0 ? 1 : ops);
+
+    std::cout << name << ',' << type << ',' << n << ',' << ops << ','
+              << seconds << ',' << seconds * 1e9 / count << ','
+              << static_cast<double>(allocations - before) / count << '\n';
+  }
+
+  // Tracks of the core suite: n entries over n / 8 distinct tracks.
+  template <typename T>
+  struct tracks;
+
+  template <>
+  struct tracks<int> {
+    static constexpr std::string_view name = "int";
+    explicit tracks(std::size_t) {}
+    int operator()(std::size_t i) const { return static_cast<int>(i); }
+  };
+
+  template <>
+  struct tracks<std::string> {
+    static constexpr std::string_view name = "string";
+    std::vector<std::string> names;
+    explicit tracks(std::size_t distinct) {
+      names.reserve(distinct);
+      for (std::size_t i = 0; i < distinct; ++i)
+        names.push_back("track-" + std::to_string(i * 7919 % distinct));
+    }
+    std::string const &operator()(std::size_t i) const { return names[i]; }
+  };
+
+  template <>
+  struct tracks<std::string_view> {
+    static constexpr std::string_view name = "string_view";
+    tracks<std::string> storage;
+    explicit tracks(std::size_t distinct) : storage(distinct) {}
+    std::string_view operator()(std::size_t i) const { return storage(i); }
+  };
+
+  // push_back, pop_front, remove, copy + first write, params() on shared
+  // data, play traversal and sorted traversal with pay().
+  template <typename T>
+  void bench_core(std::size_t n) {
+    using playlist_t = cxx::playlist<T, int>;
+    std::size_t distinct = n / 8 == 0 ? 1 : n / 8;
+    tracks<T> track(distinct);
+    auto type = tracks<T>::name;
+    auto fill = [&](playlist_t &pl) {
+      for (std::size_t i = 0; i < n; ++i)
+        pl.push_back(track(i % distinct), static_cast<int>(i));
+    };
+
+    playlist_t pl;
+    run("push_back", type, n, n, [&] { fill(pl); });
+
+    playlist_t popped = pl;
+    popped.push_back(track(0), 0);
+    run("pop_front", type, n, n, [&] {
+      for (std::size_t i = 0; i < n; ++i)
+        popped.pop_front();
+    });
+
+    std::size_t removals = distinct < 1000 ? distinct : 1000;
+    playlist_t removed = pl;
+    removed.push_back(track(0), 0);
+    run("remove", type, n, removals, [&] {
+      for (std::size_t i = 0; i < removals; ++i)
+        removed.remove(track(i));
+    });
+
+    std::size_t rounds = n >= 1000000 ? 3 : 3000000 / n;
+    run("copy_first_write", type, n, rounds, [&] {
+      for (std::size_t i = 0; i < rounds; ++i) {
+        playlist_t copy = pl;
+        copy.push_back(track(0), 0);
+        keep(copy);
+      }
+    });
+    run("params_shared", type, n, rounds, [&] {
+      for (std::size_t i = 0; i < rounds; ++i) {
+        playlist_t copy = pl;
+        ++copy.params(std::next(copy.play_begin(), 1));
+        keep(copy);
+      }
+    });
+
+    long long sum = 0;
+    run("play_traversal", type, n, n, [&] {
+      for (auto it = pl.play_begin(); it != pl.play_end(); ++it)
+        sum += pl.play(it).second;
+    });
+    run("sorted_traversal", type, n, distinct, [&] {
+      for (auto it = pl.sorted_begin(); it != pl.sorted_end(); ++it)
+        sum += static_cast<long long>(pl.pay(it).second);
+    });
+    keep(sum);
+  }
+
+  // Steady-state appends to a "recently played" history of n entries:
+  // bounded playlist against push_back + pop_front on an unbounded one.
+  void bench_bounded_append(std::size_t n, std::size_t ops) {
+    cxx::playlist<int, int> bounded(n);
+    cxx::playlist<int, int> manual;
+    for (std::size_t i = 0; i < n; ++i) {
+      bounded.push_back(static_cast<int>(i % 1024), 0);
+      manual.push_back(static_cast<int>(i % 1024), 0);
+    }
+
+    run("bounded_append", "int", n, ops, [&] {
+      for (std::size_t i = 0; i < ops; ++i)
+        bounded.push_back(static_cast<int>(i % 1024), static_cast<int>(i));
+    });
+    run("push_pop_append", "int", n, ops, [&] {
+      for (std::size_t i = 0; i < ops; ++i) {
+        manual.push_back(static_cast<int>(i % 1024), static_cast<int>(i));
+        manual.pop_front();
+      }
+    });
+    keep(bounded);
+    keep(manual);
+  }
+
+  // Visiting all entries in a random order: shuffle_view against copying
+  // play() results into a vector and shuffling it.
+  void bench_shuffle(std::size_t n) {
+    cxx::playlist<int, int> pl;
+    for (std::size_t i = 0; i < n; ++i)
+      pl.push_back(static_cast<int>(i % 1024), static_cast<int>(i));
+    (void)pl.shuffle_view(0);
+
+    long long sum = 0;
+    run("shuffle_view", "int", n, n, [&] {
+      for (auto [track, params] : pl.shuffle_view(12345))
+        sum += track + params;
+    });
+    run("shuffle_vector_copy", "int", n, n, [&] {
+      std::vector<std::pair<int, int>> copy;
+      copy.reserve(pl.size());
+      for (auto it = pl.play_begin(); it != pl.play_end(); ++it)
+        copy.emplace_back(pl.play(it));
+      std::shuffle(copy.begin(), copy.end(), std::mt19937_64(12345));
+      for (auto [track, params] : copy)
+        sum += track + params;
+    });
+    keep(sum);
+  }
+
+  // Creating, filling and destroying many small playlists.
+  void bench_small_playlists(std::size_t entries, std::size_t count) {
+    std::size_t total = 0;
+    run("small_playlist_lifecycle", "int", entries, count, [&] {
+      for (std::size_t i = 0; i < count; ++i) {
+        cxx::playlist<int, int> pl;
+        for (std::size_t j = 0; j < entries; ++j)
+          pl.push_back(static_cast<int>(j % 4), static_cast<int>(j));
+        total += pl.size();
+      }
+    });
+    keep(total);
+  }
+
+  // First modification of a freshly copied (shared) playlist, which has
+  // to duplicate the data.
+  void bench_shared_first_write(std::size_t n, std::size_t rounds) {
+    cxx::playlist<std::string, int> base;
+    for (std::size_t i = 0; i < n; ++i)
+      base.push_back("track" + std::to_string(i % (n / 4 + 1)),
+                     static_cast<int>(i));
+
+    run("shared_pop_front", "string", n, rounds, [&] {
+      for (std::size_t i = 0; i < rounds; ++i) {
+        auto copy = base;
+        copy.pop_front();
+        keep(copy);
+      }
+    });
+    run("shared_push_back", "string", n, rounds, [&] {
+      for (std::size_t i = 0; i < rounds; ++i) {
+        auto copy = base;
+        copy.push_back("track0", 0);
+        keep(copy);
+      }
+    });
+    run("shared_remove", "string", n, rounds, [&] {
+      for (std::size_t i = 0; i < rounds; ++i) {
+        auto copy = base;
+        copy.remove("track1");
+        keep(copy);
+      }
+    });
+  }
+
+  // Metadata editor loop: edit one entry, then hand out a copy that is
+  // read and dropped.
+  void bench_edit_then_copy(std::size_t n, std::size_t rounds) {
+    cxx::playlist<int, int> via_params, via_update;
+    for (std::size_t i = 0; i < n; ++i) {
+      via_params.push_back(static_cast<int>(i % 1024), 0);
+      via_update.push_back(static_cast<int>(i % 1024), 0);
+    }
+
+    long long sum = 0;
+    run("edit_params_then_copy", "int", n, rounds, [&] {
+      for (std::size_t i = 0; i < rounds; ++i) {
+        ++via_params.params(via_params.play_begin());
+        auto copy = via_params;
+        sum += copy.front().second;
+      }
+    });
+    run("update_params_then_copy", "int", n, rounds, [&] {
+      for (std::size_t i = 0; i < rounds; ++i) {
+        via_update.update_params(via_update.play_begin(), [](int &p) { ++p; });
+        auto copy = via_update;
+        sum += copy.front().second;
+      }
+    });
+    keep(sum);
+  }
+
+  // Building a day schedule out of hourly blocks of n entries: append()
+  // of each block against pushing its entries one by one.
+  void bench_concatenation(std::size_t n, std::size_t blocks) {
+    auto block = [&](std::size_t hour) {
+      cxx::playlist<std::string, int> pl;
+      for (std::size_t i = 0; i < n; ++i)
+        pl.push_back("track" + std::to_string((hour * 7 + i) % (n / 8)),
+                     static_cast<int>(i));
+      return pl;
+    };
+    std::vector<cxx::playlist<std::string, int>> hours, copies;
+    for (std::size_t h = 0; h < blocks; ++h)
+      hours.push_back(block(h));
+    copies = hours;
+    for (auto &copy : copies)
+      copy.push_back("detached", 0);
+
+    cxx::playlist<std::string, int> by_append, by_push;
+    run("append_blocks", "string", n, blocks, [&] {
+      for (auto &hour : hours)
+        by_append.append(std::move(hour));
+    });
+    run("push_back_blocks", "string", n, blocks, [&] {
+      for (auto const &hour : copies)
+        for (auto it = hour.play_begin(); it != hour.play_end(); ++it)
+          by_push.push_back(hour.play(it).first, hour.play(it).second);
+    });
+    keep(by_append);
+    keep(by_push);
+  }
+
+  // Live programming change: put one entry in the middle of the play
+  // order and drop it again. insert() + erase() against rebuilding the
+  // playlist around the change.
+  void bench_positional(std::size_t n, std::size_t rounds) {
+    cxx::playlist<int, int> pl;
+    for (std::size_t i = 0; i < n; ++i)
+      pl.push_back(static_cast<int>(i % 1024), static_cast<int>(i));
+    auto middle = std::next(pl.play_begin(), static_cast<std::ptrdiff_t>(n / 2));
+
+    run("insert_erase_middle", "int", n, rounds, [&] {
+      for (std::size_t i = 0; i < rounds; ++i)
+        middle = pl.erase(pl.insert(middle, static_cast<int>(i % 1024), 0));
+    });
+    run("rebuild_insert_middle", "int", n, rounds, [&] {
+      for (std::size_t i = 0; i < rounds; ++i) {
+        cxx::playlist<int, int> rebuilt;
+        std::size_t at = 0;
+        for (auto it = pl.play_begin(); it != pl.play_end(); ++it, ++at) {
+          if (at == n / 2)
+            rebuilt.push_back(static_cast<int>(i % 1024), 0);
+          rebuilt.push_back(pl.play(it).first, pl.play(it).second);
+        }
+        keep(rebuilt);
+      }
+    });
+  }
+
+  // Ingest of n "track played" events from the given number of writer
+  // threads: a playlist behind one mutex against sharded_playlist with a
+  // shard per writer. The final flush is part of the measured time.
+  void bench_writers(std::size_t n, std::size_t threads) {
+    auto write = [&](auto push) {
+      std::vector<std::thread> writers;
+      for (std::size_t t = 0; t < threads; ++t)
+        writers.emplace_back([&, t] {
+          for (std::size_t i = t; i < n; i += threads)
+            push(static_cast<int>(i % 4096), static_cast<int>(i));
+        });
+      for (auto &w : writers)
+        w.join();
+    };
+
+    run("mutex_push_back", "int", threads, n, [&] {
+      std::mutex mutex;
+      cxx::playlist<int, int> pl;
+      write([&](int track, int params) {
+        std::lock_guard<std::mutex> lock(mutex);
+        pl.push_back(track, params);
+      });
+      keep(pl);
+    });
+    run("sharded_push_back", "int", threads, n, [&] {
+      cxx::sharded_playlist<int, int> pl(threads);
+      write([&](int track, int params) { pl.push_back(track, params); });
+      keep(pl.snapshot());
+    });
+  }
+
+  // The same ingest through ingest_queue: producers never take a lock and
+  // one consumer thread drains the ring into the playlist in batches.
+  void bench_ingest_queue(std::size_t n, std::size_t producers) {
+    run("ingest_queue_push", "int", producers, n, [&] {
+      cxx::ingest_queue<int, int> queue;
+      cxx::playlist<int, int> pl;
+      std::atomic<std::size_t> done{0};
+      std::thread consumer([&] {
+        while (done.load() < producers)
+          if (queue.drain(pl) == 0)
+            std::this_thread::yield();
+        queue.drain(pl);
+      });
+      std::vector<std::thread> writers;
+      for (std::size_t t = 0; t < producers; ++t)
+        writers.emplace_back([&, t] {
+          for (std::size_t i = t; i < n; i += producers)
+            queue.push(static_cast<int>(i % 4096), static_cast<int>(i));
+          ++done;
+        });
+      for (auto &w : writers)
+        w.join();
+      consumer.join();
+      keep(pl);
+    });
+  }
+
+  // Reads a track, so that traversals touch the index nodes.
+  std::size_t weight(int track) { return static_cast<std::size_t>(track); }
+  std::size_t weight(std::string const &track) { return track.size(); }
+
+  // Streaming server glue: play_stream() and pay_stream() against the
+  // manual iterator loops they replace, over n entries whose tracks are
+  // scattered in memory relative to the play order.
+  template <typename T>
+  void bench_stream(std::size_t n) {
+    std::size_t distinct = n / 4;
+    tracks<T> track(distinct);
+    auto type = tracks<T>::name;
+    cxx::playlist<T, int> pl;
+    for (std::size_t i = 0; i < n; ++i)
+      pl.push_back(track(i * 7919 % distinct), static_cast<int>(i));
+
+    std::size_t sum = 0;
+    run("play_loop", type, n, n, [&] {
+      for (auto it = pl.play_begin(); it != pl.play_end(); ++it)
+        sum += weight(pl.play(it).first) + pl.play(it).second;
+    });
+    run("play_stream", type, n, n, [&] {
+      for (auto [t, params] : cxx::play_stream(pl))
+        sum += weight(t) + params;
+    });
+    run("pay_loop", type, n, distinct, [&] {
+      for (auto it = pl.sorted_begin(); it != pl.sorted_end(); ++it)
+        sum += weight(pl.pay(it).first) + pl.pay(it).second;
+    });
+    run("pay_stream", type, n, distinct, [&] {
+      for (auto [t, count] : cxx::pay_stream(pl))
+        sum += weight(t) + count;
+    });
+    keep(sum);
+  }
+
+  // Reduction over the params in play order: a ranges pipeline over
+  // play_view() against batches() of 256 params summed as spans.
+  void bench_batches(std::size_t n) {
+    cxx::playlist<int, int> pl;
+    for (std::size_t i = 0; i < n; ++i)
+      pl.push_back(static_cast<int>(i % 1024), static_cast<int>(i));
+
+    long long sum = 0;
+    run("play_view_params", "int", n, n, [&] {
+      for (int params : pl.play_view() | std::views::values)
+        sum += params;
+    });
+    run("batched_params", "int", n, n, [&] {
+      for (auto span : pl.batches(256))
+        for (int params : span)
+          sum += params;
+    });
+    keep(sum);
+  }
+
+  // Analytics over n entries with {start, end} params: count the plays
+  // longer than 180 s and aggregate their lengths. A traversal of the
+  // play order against to_columns() followed by the column kernels, in
+  // their scalar, SSE2 and (if supported) AVX2 versions.
+  void bench_columns(std::size_t n) {
+    using params_t = std::pair<unsigned, unsigned>;
+    cxx::playlist<int, params_t> pl;
+    std::mt19937 rng(45);
+    for (std::size_t i = 0; i < n; ++i) {
+      unsigned start = rng() % 100000;
+      pl.push_back(static_cast<int>(i % 4096), {start, start + rng() % 400});
+    }
+
+    std::uint64_t sum = 0;
+    run("filter_play_view", "pair", n, n, [&] {
+      unsigned lo = ~0u, hi = 0;
+      for (auto [track, params] : pl.play_view()) {
+        unsigned length = params.second - params.first;
+        if (length > 180) {
+          ++sum;
+          sum += length;
+          lo = length < lo ? length : lo;
+          hi = length > hi ? length : hi;
+        }
+      }
+      sum += lo + hi;
+    });
+
+    cxx::playlist_columns<int, params_t> cols;
+    run("to_columns", "pair", n, n, [&] { cols = cxx::to_columns(pl); });
+    if (cols.size() != n) // to_columns filtered out
+      cols = cxx::to_columns(pl);
+
+    cxx::column<std::uint32_t> length(n), selected(n);
+    auto kernels = [&](auto simd) {
+      using K = decltype(simd);
+      K::difference(cols.field<1>().data(), cols.field<0>().data(),
+                    length.data(), n);
+      std::size_t found =
+          K::select_greater(length.data(), n, 180, selected.data());
+      for (std::size_t i = 0; i < found; ++i)
+        selected[i] = length[selected[i]];
+      sum += K::count_greater(length.data(), n, 180);
+      sum += K::sum(selected.data(), found);
+      auto [lo, hi] = K::min_max(selected.data(), found);
+      sum += lo + hi;
+    };
+    run("filter_columns_scalar", "pair", n, n,
+        [&] { kernels(cxx::simd::scalar()); });
+    run("filter_columns_sse2", "pair", n, n,
+        [&] { kernels(cxx::simd::sse2()); });
+    if (cxx::simd::has_avx2())
+      run("filter_columns_avx2", "pair", n, n,
+          [&] { kernels(cxx::simd::avx2()); });
+    keep(sum);
+  }
+
+  // Scheduling UI with undo: each edit of a playlist of n entries keeps
+  // a full copy as its undo state (and so detaches the working copy)
+  // against undo_playlist recording inverse operations. Then all edits
+  // are undone.
+  void bench_undo(std::size_t n, std::size_t edits) {
+    auto track = [](std::size_t i) { return "track" + std::to_string(i % 1024); };
+    cxx::playlist<std::string, int> base;
+    cxx::undo_playlist<std::string, int> undoable(edits);
+    for (std::size_t i = 0; i < n; ++i) {
+      base.push_back(track(i), static_cast<int>(i));
+      undoable.push_back(track(i), static_cast<int>(i));
+    }
+
+    std::vector<cxx::playlist<std::string, int>> states;
+    run("edit_keeping_copies", "string", n, edits, [&] {
+      for (std::size_t i = 0; i < edits; ++i) {
+        states.push_back(base);
+        if (i % 2 == 0)
+          base.push_back(track(i), 0);
+        else
+          base.pop_front();
+      }
+    });
+    run("undo_copies", "string", n, edits, [&] {
+      for (; !states.empty(); states.pop_back())
+        base = std::move(states.back());
+    });
+    run("edit_undo_playlist", "string", n, edits, [&] {
+      for (std::size_t i = 0; i < edits; ++i) {
+        if (i % 2 == 0)
+          undoable.push_back(track(i), 0);
+        else
+          undoable.pop_front();
+      }
+    });
+    run("undo_undo_playlist", "string", n, edits, [&] {
+      while (undoable.can_undo())
+        undoable.undo();
+    });
+    keep(base);
+    keep(undoable);
+  }
+
+  // Long-lived scheduler holding `held` entries of a playlist of n entries
+  // across snapshots: after every snapshot and change, it gets back to its
+  // entries by walking to their positions against find() by entry id.
+  void bench_entry_ids(std::size_t n, std::size_t held) {
+    cxx::playlist<int, int> pl;
+    for (std::size_t i = 0; i < n; ++i)
+      pl.push_back(static_cast<int>(i % 1024), static_cast<int>(i));
+    std::vector<std::size_t> positions;
+    std::vector<cxx::playlist<int, int>::entry_id> ids;
+    for (std::size_t i = 0; i < held; ++i) {
+      positions.push_back(i * (n / held));
+      ids.push_back(pl.id(std::next(pl.play_begin(),
+          static_cast<std::ptrdiff_t>(positions.back()))));
+    }
+
+    long sum = 0;
+    std::vector<cxx::playlist<int, int>> snapshots;
+    auto change = [&] {
+      snapshots.push_back(pl);
+      pl.push_back(0, 0);
+    };
+    run("held_entries_walk", "int", n, held, [&] {
+      change();
+      for (std::size_t position : positions)
+        sum += pl.play(std::next(pl.play_begin(),
+            static_cast<std::ptrdiff_t>(position))).second;
+    });
+    run("held_entries_find", "int", n, held, [&] {
+      change();
+      for (auto id : ids)
+        sum += pl.play(pl.find(id)).second;
+    });
+    keep(sum);
+    keep(snapshots);
+  }
+
+  // Simulcast of two stations of n / 2 entries each, over n / 16 tracks
+  // per station (half of them shared): a new playlist filled by push_back
+  // in start time order against merge_interleaved.
+  void bench_merge(std::size_t n) {
+    auto track = [](std::size_t i) { return "track" + std::to_string(i); };
+    cxx::playlist<std::string, int> a, b;
+    std::size_t distinct = n / 16 == 0 ? 1 : n / 16;
+    for (std::size_t i = 0; i < n / 2; ++i) {
+      a.push_back(track(i % distinct), static_cast<int>(2 * i));
+      b.push_back(track(i % distinct + distinct / 2),
+                  static_cast<int>(2 * i + 1));
+    }
+
+    run("merge_push_back", "string", n, n, [&] {
+      cxx::playlist<std::string, int> merged;
+      auto ia = a.play_begin(), ib = b.play_begin();
+      while (ia != a.play_end() || ib != b.play_end()) {
+        auto &it = ib == b.play_end() ||
+                           (ia != a.play_end() && !((*ib).second < (*ia).second))
+                       ? ia
+                       : ib;
+        merged.push_back((*it).first, (*it).second);
+        ++it;
+      }
+      keep(merged);
+    });
+    run("merge_interleaved", "string", n, n, [&] {
+      keep(cxx::merge_interleaved(a, b, std::identity{}));
+    });
+  }
+
+  // Read-mostly use of a loaded schedule of n entries over n / 4 tracks:
+  // sorted traversal through the map (sorted_begin() + pay()) against
+  // the flat index (sorted_index()), and count() against std::map::find.
+  template <typename T>
+  void bench_sorted_index(std::size_t n) {
+    std::size_t distinct = n / 4;
+    tracks<T> track(distinct);
+    auto type = tracks<T>::name;
+    cxx::playlist<T, int> pl;
+    std::map<T, std::size_t> counts;
+    for (std::size_t i = 0; i < n; ++i) {
+      std::size_t t = i * 7919 % distinct;
+      pl.push_back(track(t), static_cast<int>(i));
+      ++counts[track(t)];
+    }
+    (void)pl.sorted_index();
+
+    std::size_t sum = 0;
+    run("sorted_traversal_map", type, n, distinct, [&] {
+      for (auto it = pl.sorted_begin(); it != pl.sorted_end(); ++it)
+        sum += pl.pay(it).second;
+    });
+    run("sorted_traversal_flat", type, n, distinct, [&] {
+      for (auto [name, count] : pl.sorted_index())
+        sum += count;
+    });
+
+    std::size_t lookups = 1000000;
+    run("lookup_std_map", type, n, lookups, [&] {
+      for (std::size_t i = 0; i < lookups; ++i)
+        sum += counts.find(track(i * 104729 % distinct))->second;
+    });
+    run("lookup_flat", type, n, lookups, [&] {
+      for (std::size_t i = 0; i < lookups; ++i)
+        sum += pl.count(track(i * 104729 % distinct));
+    });
+    keep(sum);
+  }
+
+  // Nightly royalty report over a schedule of `distinct` tracks played
+  // once each, added in scattered order so that neighbours in sorted
+  // order lie far apart in memory. Each track costs a few dozen
+  // instructions (a hash and a rate), and before each run the caches are
+  // flushed by streaming over a buffer larger than the last level cache.
+  // Tree walk with pay() against the flat index and for_each_sorted(),
+  // which fetches index nodes ahead.
+  template <typename T>
+  void bench_sorted_cold(std::size_t distinct) {
+    tracks<T> track(distinct);
+    auto type = tracks<T>::name;
+    cxx::playlist<T, int> pl;
+    for (std::size_t i = 0; i < distinct; ++i)
+      pl.push_back(track(i * 7919 % distinct), static_cast<int>(i));
+    (void)pl.sorted_index();
+
+    std::vector<char> flush(std::size_t(512) << 20);
+    std::size_t sum = 0;
+    auto royalty = [&](T const &name, std::size_t count) {
+      std::uint64_t x = std::hash<T>()(name);
+      for (int round = 0; round < 4; ++round) {
+        x += 0x9e3779b97f4a7c15ULL;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x ^= x >> 31;
+      }
+      sum += count * (x % 1000);
+    };
+    auto cold_run = [&](std::string_view name, auto &&work) {
+      if (name.find(filter) == std::string_view::npos)
+        return;
+      for (std::size_t i = 0; i < flush.size(); i += 64)
+        flush[i] = static_cast<char>(flush[i] + 1);
+      keep(flush);
+      run(name, type, distinct, distinct, work);
+    };
+
+    cold_run("sorted_cold_map", [&] {
+      for (auto it = pl.sorted_begin(); it != pl.sorted_end(); ++it) {
+        auto [name, count] = pl.pay(it);
+        royalty(name, count);
+      }
+    });
+    cold_run("sorted_cold_flat", [&] {
+      for (auto [name, count] : pl.sorted_index())
+        royalty(name, count);
+    });
+    cold_run("sorted_cold_for_each", [&] { pl.for_each_sorted(royalty); });
+    keep(sum);
+  }
+
+  // Steady churn over 256 track values: one-byte tracks, found through
+  // the direct table, against int tracks, found through the tree.
+  template <typename T>
+  void bench_small_keys(std::string_view type, std::size_t n, std::size_t ops) {
+    cxx::playlist<T, int> pl;
+    for (std::size_t i = 0; i < n; ++i)
+      pl.push_back(static_cast<T>(i * 37 % 256), 0);
+
+    std::size_t sum = 0;
+    run("small_key_push_pop", type, n, ops, [&] {
+      for (std::size_t i = 0; i < ops; ++i) {
+        pl.push_back(static_cast<T>(i * 37 % 256), static_cast<int>(i));
+        pl.pop_front();
+      }
+    });
+    run("small_key_count", type, n, ops, [&] {
+      for (std::size_t i = 0; i < ops; ++i)
+        sum += pl.count(static_cast<T>(i * 101 % 256));
+    });
+    keep(sum);
+  }
+
+  // Journal snapshots of n entries: compact() and replay on reopening,
+  // with trivially copyable params (stored as one block) against the same
+  // bytes behind a user codec and a user-provided copy constructor (stored
+  // entry by entry).
+  template <typename P>
+  void bench_snapshot(std::string_view type, std::size_t n) {
+    std::string path =
+        (std::filesystem::temp_directory_path() / "playlist_bench.journal")
+            .string();
+    std::filesystem::remove(path);
+    {
+      cxx::journaled_playlist<int, P> journal(path, n, 0);
+      for (std::size_t i = 0; i < n; ++i)
+        journal.push_back(static_cast<int>(i % 1024),
+                          P(static_cast<unsigned>(i), 1));
+      run("journal_compact", type, n, n, [&] { journal.compact(); });
+    }
+    // Tearing the playlist down is left out of the replay time.
+    std::optional<cxx::journaled_playlist<int, P>> reopened;
+    run("journal_replay", type, n, n, [&] { reopened.emplace(path, n, 0); });
+    keep(reopened ? reopened->get().size() : 0);
+    reopened.reset();
+    std::filesystem::remove(path);
+  }
+
+  // Heap bytes taken by building a container with make().
+  template <typename F>
+  std::size_t heap_bytes(F &&make) {
+    std::size_t before = live_bytes;
+    auto built = make();
+    std::size_t after = live_bytes;
+    keep(built);
+    return after - before;
+  }
+
+  // Bytes per entry of n entries over distinct tracks: the playlist (as
+  // measured and as reported by memory_usage), a vector with a map of
+  // counts, and a list with a multimap of positions.
+  template <typename T>
+  void bench_memory(std::size_t n, std::size_t distinct) {
+    tracks<T> track(distinct);
+    auto type = tracks<T>::name;
+    auto report = [&](std::string_view layout, std::size_t bytes) {
+      std::cout << layout << ',' << type << ',' << n << ',' << distinct << ','
+                << static_cast<double>(bytes) / static_cast<double>(n) << '\n';
+    };
+
+    // Built on a fresh thread, whose node pool holds no cached blocks.
+    std::size_t measured = 0, reported = 0;
+    std::thread([&] {
+      measured = heap_bytes([&] {
+        cxx::playlist<T, int> pl;
+        for (std::size_t i = 0; i < n; ++i)
+          pl.push_back(track(i % distinct), static_cast<int>(i));
+        reported = pl.memory_usage().total();
+        return pl;
+      });
+    }).join();
+    report("playlist", measured);
+    report("playlist_reported", reported);
+
+    report("vector_count_map", heap_bytes([&] {
+      std::pair<std::vector<std::pair<T, int>>, std::map<T, std::size_t>> l;
+      for (std::size_t i = 0; i < n; ++i) {
+        l.first.emplace_back(track(i % distinct), static_cast<int>(i));
+        ++l.second[track(i % distinct)];
+      }
+      return l;
+    }));
+
+    using list_t = std::list<std::pair<T, int>>;
+    report("list_multimap", heap_bytes([&] {
+      std::pair<list_t, std::multimap<T, typename list_t::iterator>> l;
+      for (std::size_t i = 0; i < n; ++i) {
+        l.first.emplace_back(track(i % distinct), static_cast<int>(i));
+        l.second.emplace(track(i % distinct), std::prev(l.first.end()));
+      }
+      return l;
+    }));
+  }
+}
+
+int main(int argc, char *argv[]) {
+  if (argc > 1 && std::string_view(argv[1]) == "memory") {
+    std::size_t max_size = argc > 2 ? std::stoul(argv[2]) : 1000000;
+    std::cout << "layout,type,n,distinct,bytes_per_entry\n";
+    for (std::size_t n = 1000; n <= max_size; n *= 10) {
+      for (std::size_t distinct : {n / 8, n}) {
+        bench_memory<int>(n, distinct);
+        bench_memory<std::string>(n, distinct);
+      }
+    }
+    return 0;
+  }
+
+  std::size_t max_size = argc > 1 ? std::stoul(argv[1]) : 1000000;
+  if (argc > 2)
+    filter = argv[2];
+
+  std::cout << "benchmark,type,n,ops,seconds,ns_per_op,allocs_per_op\n";
+  for (std::size_t n = 1000; n <= max_size; n *= 10) {
+    bench_core<int>(n);
+    bench_core<std::string_view>(n);
+    bench_core<std::string>(n);
+  }
+
+  for (std::size_t n : {1000u, 100000u})
+    bench_bounded_append(n, 1000000);
+  bench_shuffle(1000000);
+  for (std::size_t entries : {0u, 4u, 16u})
+    bench_small_playlists(entries, 1000000);
+  bench_shared_first_write(100000, 20);
+  bench_edit_then_copy(100000, 100);
+  bench_concatenation(10000, 24);
+  bench_positional(100000, 20);
+  bench_batches(1000000);
+  bench_columns(10000000);
+  bench_undo(100000, 100);
+  bench_entry_ids(100000, 1000);
+  for (std::size_t n : {10000u, 1000000u})
+    bench_merge(n);
+  bench_snapshot<std::pair<unsigned, unsigned>>("trivial_params", 1000000);
+  bench_snapshot<boxed_params>("boxed_params", 1000000);
+  bench_small_keys<signed char>("signed_char", 100000, 1000000);
+  bench_small_keys<int>("int", 100000, 1000000);
+  for (std::size_t n : {10000u, 1000000u}) {
+    bench_sorted_index<int>(n);
+    bench_sorted_index<std::string>(n);
+    bench_stream<int>(n);
+    bench_stream<std::string>(n);
+  }
+  bench_sorted_cold<int>(3000000);
+  bench_sorted_cold<std::string>(3000000);
+  for (std::size_t threads = 1; threads <= 64; threads *= 2) {
+    bench_writers(1000000, threads);
+    bench_ingest_queue(1000000, threads);
+  }
+  return 0;
+}
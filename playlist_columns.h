@@ -0,0 +1,570 @@
+#ifndef PLAYLIST_COLUMNS_H
+#define PLAYLIST_COLUMNS_H
+
+#include "playlist.h"
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <new>
+#include <span>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#  define CXX_PLAYLIST_X86 1
+#  include <immintrin.h>
+#endif
+
+namespace cxx
+{
+
+    // Allocator aligning arrays to cache lines, and so to any vector width.
+    template <typename U>
+    struct aligned_allocator
+    {
+        using value_type = U;
+        static constexpr std::align_val_t alignment{64};
+
+        aligned_allocator() noexcept = default;
+
+        template <typename V>
+        aligned_allocator(aligned_allocator<V> const &) noexcept {}
+
+        U *allocate(size_t n)
+        {
+            return static_cast<U *>(::operator new(n * sizeof(U), alignment));
+        }
+
+        void deallocate(U *p, size_t) noexcept
+        {
+            ::operator delete(p, alignment);
+        }
+
+        template <typename V>
+        bool operator==(aligned_allocator<V> const &) const noexcept
+        {
+            return true;
+        }
+    };
+
+    template <typename U>
+    using column = std::vector<U, aligned_allocator<U>>;
+
+    // Splits params into the fields exported by to_columns(), returned as a
+    // tuple of arithmetic values. Provided for arithmetic types, pairs and
+    // tuples of them; specialise it for other params types.
+    template <typename P, typename = void>
+    struct param_columns
+    {
+        static_assert(sizeof(P) == 0,
+            "param_columns: specialise cxx::param_columns for this type");
+    };
+
+    template <typename P>
+    struct param_columns<P, std::enable_if_t<std::is_arithmetic_v<P>>>
+    {
+        static std::tuple<P> get(P const &params) { return {params}; }
+    };
+
+    template <typename A, typename B>
+    struct param_columns<std::pair<A, B>>
+    {
+        static std::tuple<A, B> get(std::pair<A, B> const &params)
+        {
+            return {params.first, params.second};
+        }
+    };
+
+    template <typename... F>
+    struct param_columns<std::tuple<F...>>
+    {
+        static std::tuple<F...> get(std::tuple<F...> const &params)
+        {
+            return params;
+        }
+    };
+
+    // Columnar copy of a playlist in play order: row i holds the i-th entry
+    // as an index into the sorted distinct tracks and the fields of its
+    // params, each field in its own aligned array.
+    template <typename T, typename P>
+    struct playlist_columns
+    {
+    private:
+        using field_values = decltype(param_columns<P>::get(
+            std::declval<P const &>()));
+
+        template <typename Tuple>
+        struct columns_of;
+        template <typename... F>
+        struct columns_of<std::tuple<F...>>
+        {
+            using type = std::tuple<column<F>...>;
+        };
+
+    public:
+        std::vector<T> tracks;            // distinct tracks in sorted order
+        column<std::uint32_t> track_ids;  // per row, index into tracks
+        typename columns_of<field_values>::type fields;
+
+        size_t size() const noexcept
+        {
+            return track_ids.size();
+        }
+
+        // Gets the I-th field of all rows.
+        template <size_t I>
+        auto field() const noexcept
+        {
+            auto const &values = std::get<I>(fields);
+            return std::span(values.data(), values.size());
+        }
+    };
+
+    // Exports the playlist into columns. Rows are numbered with 32 bits, so
+    // it throws std::length_error for 2^32 entries or more.
+    // O(n) expected.
+    template <typename T, typename P>
+    playlist_columns<T, P> to_columns(playlist<T, P> const &pl)
+    {
+        using fields_t = decltype(playlist_columns<T, P>::fields);
+
+        if (pl.size() > std::numeric_limits<std::uint32_t>::max())
+            throw std::length_error("to_columns, too many entries");
+
+        playlist_columns<T, P> out;
+        std::unordered_map<T const *, std::uint32_t> ids;
+        for (T const &track : pl.sorted_view())
+        {
+            ids.emplace(&track, static_cast<std::uint32_t>(out.tracks.size()));
+            out.tracks.push_back(track);
+        }
+
+        out.track_ids.reserve(pl.size());
+        std::apply([&](auto &...columns) { (columns.reserve(pl.size()), ...); },
+            out.fields);
+        for (auto [track, params] : pl.play_view())
+        {
+            out.track_ids.push_back(ids.find(&track)->second);
+            [&]<size_t... I>(std::index_sequence<I...>)
+            {
+                auto values = param_columns<P>::get(params);
+                (std::get<I>(out.fields).push_back(std::get<I>(values)), ...);
+            }(std::make_index_sequence<std::tuple_size_v<fields_t>>());
+        }
+        return out;
+    }
+
+    // --- Kernels over std::uint32_t columns ---
+    //
+    // Each kernel has a scalar version, an SSE2 version (the x86-64
+    // baseline) and an AVX2 version picked at run time when the processor
+    // supports it. Unsigned comparisons are done on values with the sign
+    // bit flipped, since SSE2 and AVX2 only compare signed integers.
+    // Columns hold fewer than 2^32 rows, like those of to_columns().
+
+    namespace simd
+    {
+        // The tails left over by the vector loops are passed on as (values +
+        // i, n - i), with base = i numbering the selected rows.
+        struct scalar
+        {
+            static void difference(std::uint32_t const *hi,
+                std::uint32_t const *lo, std::uint32_t *out, size_t n) noexcept
+            {
+                for (size_t i = 0; i < n; ++i)
+                    out[i] = hi[i] - lo[i];
+            }
+
+            static size_t select_greater(std::uint32_t const *values, size_t n,
+                std::uint32_t threshold, std::uint32_t *rows,
+                size_t base = 0) noexcept
+            {
+                size_t found = 0;
+                for (size_t i = 0; i < n; ++i)
+                {
+                    rows[found] = static_cast<std::uint32_t>(base + i);
+                    found += values[i] > threshold;
+                }
+                return found;
+            }
+
+            static size_t count_greater(std::uint32_t const *values, size_t n,
+                std::uint32_t threshold) noexcept
+            {
+                size_t found = 0;
+                for (size_t i = 0; i < n; ++i)
+                    found += values[i] > threshold;
+                return found;
+            }
+
+            static std::uint64_t sum(std::uint32_t const *values,
+                size_t n) noexcept
+            {
+                std::uint64_t total = 0;
+                for (size_t i = 0; i < n; ++i)
+                    total += values[i];
+                return total;
+            }
+
+            static std::pair<std::uint32_t, std::uint32_t> min_max(
+                std::uint32_t const *values, size_t n,
+                std::uint32_t lo = std::numeric_limits<std::uint32_t>::max(),
+                std::uint32_t hi = 0) noexcept
+            {
+                for (size_t i = 0; i < n; ++i)
+                {
+                    lo = values[i] < lo ? values[i] : lo;
+                    hi = values[i] > hi ? values[i] : hi;
+                }
+                return {lo, hi};
+            }
+        };
+
+#ifdef CXX_PLAYLIST_X86
+        struct sse2
+        {
+            static __m128i flip(__m128i v) noexcept
+            {
+                return _mm_xor_si128(v, _mm_set1_epi32(INT32_MIN));
+            }
+
+            static __m128i load(std::uint32_t const *p) noexcept
+            {
+                return _mm_loadu_si128(reinterpret_cast<__m128i const *>(p));
+            }
+
+            static void difference(std::uint32_t const *hi,
+                std::uint32_t const *lo, std::uint32_t *out, size_t n) noexcept
+            {
+                size_t i = 0;
+                for (; i + 4 <= n; i += 4)
+                {
+                    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i),
+                        _mm_sub_epi32(load(hi + i), load(lo + i)));
+                }
+                scalar::difference(hi + i, lo + i, out + i, n - i);
+            }
+
+            // SSE2 cannot compact lanes, so the rows of a mask are written
+            // one by one, without branching.
+            static size_t select_greater(std::uint32_t const *values, size_t n,
+                std::uint32_t threshold, std::uint32_t *rows) noexcept
+            {
+                __m128i limit = flip(_mm_set1_epi32(static_cast<int>(threshold)));
+                size_t found = 0, i = 0;
+                for (; i + 4 <= n; i += 4)
+                {
+                    auto mask = static_cast<unsigned>(_mm_movemask_ps(
+                        _mm_castsi128_ps(_mm_cmpgt_epi32(
+                            flip(load(values + i)), limit))));
+                    for (unsigned lane = 0; lane < 4; ++lane)
+                    {
+                        rows[found] = static_cast<std::uint32_t>(i + lane);
+                        found += (mask >> lane) & 1;
+                    }
+                }
+                return found + scalar::select_greater(values + i, n - i,
+                    threshold, rows + found, i);
+            }
+
+            static size_t count_greater(std::uint32_t const *values, size_t n,
+                std::uint32_t threshold) noexcept
+            {
+                __m128i limit = flip(_mm_set1_epi32(static_cast<int>(threshold)));
+                __m128i counts = _mm_setzero_si128();
+                size_t i = 0;
+                for (; i + 4 <= n; i += 4)
+                {
+                    // Matching lanes are -1: subtracting counts them.
+                    counts = _mm_sub_epi32(counts,
+                        _mm_cmpgt_epi32(flip(load(values + i)), limit));
+                }
+                alignas(16) std::uint32_t lanes[4];
+                _mm_store_si128(reinterpret_cast<__m128i *>(lanes), counts);
+                return size_t{lanes[0]} + lanes[1] + lanes[2] + lanes[3] +
+                    scalar::count_greater(values + i, n - i, threshold);
+            }
+
+            static std::uint64_t sum(std::uint32_t const *values,
+                size_t n) noexcept
+            {
+                __m128i total = _mm_setzero_si128();
+                __m128i zero = _mm_setzero_si128();
+                size_t i = 0;
+                for (; i + 4 <= n; i += 4)
+                {
+                    __m128i v = load(values + i);
+                    total = _mm_add_epi64(total, _mm_unpacklo_epi32(v, zero));
+                    total = _mm_add_epi64(total, _mm_unpackhi_epi32(v, zero));
+                }
+                alignas(16) std::uint64_t lanes[2];
+                _mm_store_si128(reinterpret_cast<__m128i *>(lanes), total);
+                return lanes[0] + lanes[1] + scalar::sum(values + i, n - i);
+            }
+
+            static std::pair<std::uint32_t, std::uint32_t> min_max(
+                std::uint32_t const *values, size_t n) noexcept
+            {
+                __m128i lo = _mm_set1_epi32(INT32_MAX);
+                __m128i hi = _mm_set1_epi32(INT32_MIN);
+                size_t i = 0;
+                for (; i + 4 <= n; i += 4)
+                {
+                    __m128i v = flip(load(values + i));
+                    __m128i less = _mm_cmplt_epi32(v, lo);
+                    lo = _mm_or_si128(_mm_and_si128(less, v),
+                        _mm_andnot_si128(less, lo));
+                    __m128i greater = _mm_cmpgt_epi32(v, hi);
+                    hi = _mm_or_si128(_mm_and_si128(greater, v),
+                        _mm_andnot_si128(greater, hi));
+                }
+                alignas(16) std::uint32_t los[4], his[4];
+                _mm_store_si128(reinterpret_cast<__m128i *>(los), flip(lo));
+                _mm_store_si128(reinterpret_cast<__m128i *>(his), flip(hi));
+                return scalar::min_max(values + i, n - i,
+                    scalar::min_max(los, 4).first,
+                    scalar::min_max(his, 4).second);
+            }
+        };
+
+        struct avx2
+        {
+            // Lane permutations moving the lanes set in a mask to the front.
+            static constexpr auto compaction = []
+            {
+                std::array<std::array<std::uint32_t, 8>, 256> table{};
+                for (unsigned mask = 0; mask < 256; ++mask)
+                {
+                    unsigned next = 0;
+                    for (unsigned lane = 0; lane < 8; ++lane)
+                    {
+                        if (mask & (1u << lane))
+                            table[mask][next++] = lane;
+                    }
+                }
+                return table;
+            }();
+
+            __attribute__((target("avx2")))
+            static __m256i flip(__m256i v) noexcept
+            {
+                return _mm256_xor_si256(v, _mm256_set1_epi32(INT32_MIN));
+            }
+
+            __attribute__((target("avx2")))
+            static __m256i load(std::uint32_t const *p) noexcept
+            {
+                return _mm256_loadu_si256(reinterpret_cast<__m256i const *>(p));
+            }
+
+            __attribute__((target("avx2")))
+            static void difference(std::uint32_t const *hi,
+                std::uint32_t const *lo, std::uint32_t *out, size_t n) noexcept
+            {
+                size_t i = 0;
+                for (; i + 8 <= n; i += 8)
+                {
+                    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i),
+                        _mm256_sub_epi32(load(hi + i), load(lo + i)));
+                }
+                scalar::difference(hi + i, lo + i, out + i, n - i);
+            }
+
+            // Stores all 8 permuted row numbers and keeps the selected ones;
+            // found <= i, so the store stays within the first n rows.
+            __attribute__((target("avx2")))
+            static size_t select_greater(std::uint32_t const *values, size_t n,
+                std::uint32_t threshold, std::uint32_t *rows) noexcept
+            {
+                __m256i limit = flip(
+                    _mm256_set1_epi32(static_cast<int>(threshold)));
+                __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+                size_t found = 0, i = 0;
+                for (; i + 8 <= n; i += 8)
+                {
+                    auto mask = static_cast<unsigned>(_mm256_movemask_ps(
+                        _mm256_castsi256_ps(_mm256_cmpgt_epi32(
+                            flip(load(values + i)), limit))));
+                    __m256i numbers = _mm256_add_epi32(lanes,
+                        _mm256_set1_epi32(static_cast<int>(i)));
+                    __m256i order = _mm256_loadu_si256(
+                        reinterpret_cast<__m256i const *>(
+                            compaction[mask].data()));
+                    _mm256_storeu_si256(reinterpret_cast<__m256i *>(rows + found),
+                        _mm256_permutevar8x32_epi32(numbers, order));
+                    found += static_cast<size_t>(std::popcount(mask));
+                }
+                return found + scalar::select_greater(values + i, n - i,
+                    threshold, rows + found, i);
+            }
+
+            __attribute__((target("avx2")))
+            static size_t count_greater(std::uint32_t const *values, size_t n,
+                std::uint32_t threshold) noexcept
+            {
+                __m256i limit = flip(
+                    _mm256_set1_epi32(static_cast<int>(threshold)));
+                __m256i counts = _mm256_setzero_si256();
+                size_t i = 0;
+                for (; i + 8 <= n; i += 8)
+                {
+                    counts = _mm256_sub_epi32(counts,
+                        _mm256_cmpgt_epi32(flip(load(values + i)), limit));
+                }
+                alignas(32) std::uint32_t lanes[8];
+                _mm256_store_si256(reinterpret_cast<__m256i *>(lanes), counts);
+                size_t found = 0;
+                for (std::uint32_t lane : lanes)
+                    found += lane;
+                return found +
+                    scalar::count_greater(values + i, n - i, threshold);
+            }
+
+            __attribute__((target("avx2")))
+            static std::uint64_t sum(std::uint32_t const *values,
+                size_t n) noexcept
+            {
+                __m256i total = _mm256_setzero_si256();
+                size_t i = 0;
+                for (; i + 8 <= n; i += 8)
+                {
+                    __m256i v = load(values + i);
+                    total = _mm256_add_epi64(total, _mm256_cvtepu32_epi64(
+                        _mm256_castsi256_si128(v)));
+                    total = _mm256_add_epi64(total, _mm256_cvtepu32_epi64(
+                        _mm256_extracti128_si256(v, 1)));
+                }
+                alignas(32) std::uint64_t lanes[4];
+                _mm256_store_si256(reinterpret_cast<__m256i *>(lanes), total);
+                return lanes[0] + lanes[1] + lanes[2] + lanes[3] +
+                    scalar::sum(values + i, n - i);
+            }
+
+            __attribute__((target("avx2")))
+            static std::pair<std::uint32_t, std::uint32_t> min_max(
+                std::uint32_t const *values, size_t n) noexcept
+            {
+                __m256i lo = _mm256_set1_epi32(-1);
+                __m256i hi = _mm256_setzero_si256();
+                size_t i = 0;
+                for (; i + 8 <= n; i += 8)
+                {
+                    __m256i v = load(values + i);
+                    lo = _mm256_min_epu32(lo, v);
+                    hi = _mm256_max_epu32(hi, v);
+                }
+                alignas(32) std::uint32_t los[8], his[8];
+                _mm256_store_si256(reinterpret_cast<__m256i *>(los), lo);
+                _mm256_store_si256(reinterpret_cast<__m256i *>(his), hi);
+                return scalar::min_max(values + i, n - i,
+                    scalar::min_max(los, 8).first,
+                    scalar::min_max(his, 8).second);
+            }
+        };
+
+        inline bool has_avx2() noexcept
+        {
+            static bool const supported = __builtin_cpu_supports("avx2");
+            return supported;
+        }
+#endif
+    } // namespace simd
+
+    // Computes out[i] = hi[i] - lo[i] (modulo 2^32), e.g. durations out of
+    // start and end columns. The spans must have the same size.
+    // O(n)
+    inline void column_difference(std::span<std::uint32_t const> hi,
+        std::span<std::uint32_t const> lo, std::span<std::uint32_t> out) noexcept
+    {
+#ifdef CXX_PLAYLIST_X86
+        if (simd::has_avx2())
+            simd::avx2::difference(hi.data(), lo.data(), out.data(),
+                out.size());
+        else
+            simd::sse2::difference(hi.data(), lo.data(), out.data(),
+                out.size());
+#else
+        simd::scalar::difference(hi.data(), lo.data(), out.data(), out.size());
+#endif
+    }
+
+    // Gets the indexes of the rows whose value is greater than threshold,
+    // in increasing order.
+    // O(n)
+    inline std::vector<std::uint32_t> column_select_greater(
+        std::span<std::uint32_t const> values, std::uint32_t threshold)
+    {
+        std::vector<std::uint32_t> rows(values.size());
+        size_t found;
+#ifdef CXX_PLAYLIST_X86
+        if (simd::has_avx2())
+            found = simd::avx2::select_greater(values.data(), values.size(),
+                threshold, rows.data());
+        else
+            found = simd::sse2::select_greater(values.data(), values.size(),
+                threshold, rows.data());
+#else
+        found = simd::scalar::select_greater(values.data(), values.size(),
+            threshold, rows.data());
+#endif
+        rows.resize(found);
+        return rows;
+    }
+
+    // Counts the rows whose value is greater than threshold.
+    // O(n)
+    inline size_t column_count_greater(std::span<std::uint32_t const> values,
+        std::uint32_t threshold) noexcept
+    {
+#ifdef CXX_PLAYLIST_X86
+        if (simd::has_avx2())
+            return simd::avx2::count_greater(values.data(), values.size(),
+                threshold);
+        return simd::sse2::count_greater(values.data(), values.size(),
+            threshold);
+#else
+        return simd::scalar::count_greater(values.data(), values.size(),
+            threshold);
+#endif
+    }
+
+    // Sums the values.
+    // O(n)
+    inline std::uint64_t column_sum(
+        std::span<std::uint32_t const> values) noexcept
+    {
+#ifdef CXX_PLAYLIST_X86
+        if (simd::has_avx2())
+            return simd::avx2::sum(values.data(), values.size());
+        return simd::sse2::sum(values.data(), values.size());
+#else
+        return simd::scalar::sum(values.data(), values.size());
+#endif
+    }
+
+    // Gets the smallest and the largest value; {max of uint32_t, 0} for no
+    // values.
+    // O(n)
+    inline std::pair<std::uint32_t, std::uint32_t> column_min_max(
+        std::span<std::uint32_t const> values) noexcept
+    {
+#ifdef CXX_PLAYLIST_X86
+        if (simd::has_avx2())
+            return simd::avx2::min_max(values.data(), values.size());
+        return simd::sse2::min_max(values.data(), values.size());
+#else
+        return simd::scalar::min_max(values.data(), values.size());
+#endif
+    }
+
+} // namespace cxx
+
+#endif // PLAYLIST_COLUMNS_H
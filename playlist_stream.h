@@ -0,0 +1,185 @@
+#ifndef PLAYLIST_STREAM_H
+#define PLAYLIST_STREAM_H
+
+#include "playlist.h"
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <version>
+
+#if defined(__cpp_lib_generator)
+#  include <generator>
+#else
+#  include <coroutine>
+#  include <exception>
+#  include <iterator>
+#  include <ranges>
+#endif
+
+namespace cxx
+{
+
+#if defined(__cpp_lib_generator)
+    template <typename Ref>
+    using generator = std::generator<Ref>;
+#else
+    // Minimal stand-in for std::generator<Ref> where the library lacks it:
+    // a move-only input range whose iterator resumes the coroutine. Ref is
+    // a value type (such as a pair of references), read back by copy.
+    template <typename Ref>
+    class generator : public std::ranges::view_interface<generator<Ref>>
+    {
+    public:
+        struct promise_type
+        {
+            Ref const *value = nullptr;
+            std::exception_ptr error;
+
+            generator get_return_object() noexcept
+            {
+                return generator(
+                    std::coroutine_handle<promise_type>::from_promise(*this));
+            }
+            std::suspend_always initial_suspend() const noexcept { return {}; }
+            std::suspend_always final_suspend() const noexcept { return {}; }
+
+            // The yielded object lives until the coroutine is resumed.
+            std::suspend_always yield_value(Ref const &v) noexcept
+            {
+                value = std::addressof(v);
+                return {};
+            }
+
+            void return_void() const noexcept {}
+            void unhandled_exception() noexcept
+            {
+                error = std::current_exception();
+            }
+            void await_transform() = delete;
+        };
+
+        class iterator
+        {
+        public:
+            using value_type = Ref;
+            using difference_type = std::ptrdiff_t;
+
+            iterator() = default;
+
+            Ref operator*() const
+            {
+                return *handle_.promise().value;
+            }
+            iterator &operator++()
+            {
+                advance();
+                return *this;
+            }
+            void operator++(int) { advance(); }
+
+            friend bool operator==(iterator const &it,
+                std::default_sentinel_t) noexcept
+            {
+                return !it.handle_ || it.handle_.done();
+            }
+
+        private:
+            friend class generator;
+            std::coroutine_handle<promise_type> handle_;
+
+            explicit iterator(std::coroutine_handle<promise_type> handle)
+                : handle_(handle) {}
+
+            void advance()
+            {
+                handle_.resume();
+                if (handle_.promise().error)
+                {
+                    std::rethrow_exception(
+                        std::exchange(handle_.promise().error, nullptr));
+                }
+            }
+        };
+
+        generator(generator &&other) noexcept
+            : handle_(std::exchange(other.handle_, nullptr)) {}
+        generator &operator=(generator other) noexcept
+        {
+            std::swap(handle_, other.handle_);
+            return *this;
+        }
+        ~generator()
+        {
+            if (handle_)
+                handle_.destroy();
+        }
+
+        // Starts the coroutine; may be called once.
+        iterator begin()
+        {
+            iterator it(handle_);
+            it.advance();
+            return it;
+        }
+        std::default_sentinel_t end() const noexcept { return {}; }
+
+    private:
+        std::coroutine_handle<promise_type> handle_;
+
+        explicit generator(std::coroutine_handle<promise_type> handle) noexcept
+            : handle_(handle) {}
+    };
+#endif
+
+    // Yields {track, params} of pl in play order. Every chunk entries the
+    // stream walks the following chunk ahead and prefetches the index
+    // nodes of their tracks, which makes up for the cost of resuming the
+    // coroutine (chunk 0 turns it off).
+    // The playlist is taken by value: streaming shares its data, and the
+    // original may be modified meanwhile (it is copied first then).
+    // O(n) for the whole stream.
+    template <typename T, typename P>
+    generator<std::pair<T const &, P const &>>
+    play_stream(playlist<T, P> pl, size_t chunk = 8)
+    {
+        auto const end = pl.play_end();
+        auto ahead = pl.play_begin();
+        auto prefetch_chunk = [&]
+        {
+            for (size_t i = 0; i < chunk && ahead != end; ++i, ++ahead)
+            {
+                __builtin_prefetch(std::addressof(pl.play(ahead).first));
+            }
+        };
+
+        prefetch_chunk();
+        size_t left = 0;
+        for (auto it = pl.play_begin(); it != end; ++it)
+        {
+            if (left == 0 && chunk != 0)
+            {
+                prefetch_chunk();
+                left = chunk;
+            }
+            --left;
+            co_yield pl.play(it);
+        }
+    }
+
+    // Yields {track, number of occurrences} of pl in sorted order. There
+    // is nothing to prefetch: each index node is only reachable through
+    // the previous one, so walking ahead would take the same misses.
+    // O(n) for the whole stream.
+    template <typename T, typename P>
+    generator<std::pair<T const &, size_t>> pay_stream(playlist<T, P> pl)
+    {
+        for (auto it = pl.sorted_begin(); it != pl.sorted_end(); ++it)
+        {
+            co_yield pl.pay(it);
+        }
+    }
+
+} // namespace cxx
+
+#endif // PLAYLIST_STREAM_H
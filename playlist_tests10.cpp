@@ -0,0 +1,162 @@
+// Węzły z puli: wpisy tworzone w wątkach producentów są zwalniane w innych.
+#define CXX_PLAYLIST_NODE_POOL
+#include "ingest_queue.h"
+
+#ifdef NDEBUG
+#  undef NDEBUG
+#endif
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// ======================== Narzędzia testowe ========================
+
+// {numer producenta, numer zdarzenia u producenta}
+using params_t = std::pair<unsigned, unsigned>;
+using queue_t = cxx::ingest_queue<std::string, params_t>;
+using playlist_t = cxx::playlist<std::string, params_t>;
+
+static std::vector<params_t> played(playlist_t const& pl) {
+    std::vector<params_t> out;
+    for (auto it = pl.play_begin(); it != pl.play_end(); ++it) {
+        out.push_back(pl.play(it).second);
+    }
+    return out;
+}
+
+// Parametry, których kopiowanie rzuca na żądanie.
+struct fragile {
+    static inline bool fail = false;
+    unsigned value = 0;
+    fragile(unsigned v) : value(v) {}
+    fragile(fragile const& other) : value(other.value) {
+        if (fail) {
+            throw std::runtime_error("copy");
+        }
+    }
+    fragile& operator=(fragile const&) = default;
+};
+
+// ======================== Testy ========================
+
+// 01: jeden producent – kolejność i pełna kolejka
+void test_01_single_producer() {
+    std::clog << "[01] single producer\n";
+    queue_t q(3);
+    playlist_t pl;
+    for (unsigned i = 0; i < 4; ++i) {
+        assert(q.try_push("t" + std::to_string(i % 2), {0, i}));
+    }
+    assert(!q.try_push("full", {0, 4}));
+    assert(q.drain(pl, 3) == 3);
+    assert(q.try_push("t0", {0, 4}));
+    assert(q.drain(pl) == 2);
+    assert(q.drain(pl) == 0);
+
+    auto items = played(pl);
+    assert(items.size() == 5);
+    for (unsigned i = 0; i < 5; ++i) {
+        assert(items[i].second == i);
+    }
+    assert(pl.pay(pl.sorted_begin()).second == 3);
+}
+
+// 02: drain odłącza współdzielone dane tylko raz i nie zmienia kopii
+void test_02_drain_into_shared() {
+    std::clog << "[02] drain into shared playlist\n";
+    queue_t q(16);
+    playlist_t pl;
+    pl.push_back("a", {9, 9});
+    playlist_t copy = pl;
+    for (unsigned i = 0; i < 10; ++i) {
+        q.push("b", {0, i});
+    }
+    assert(q.drain(pl) == 10);
+    assert(pl.size() == 11);
+    assert(copy.size() == 1);
+}
+
+// 03: wyjątek przy kopiowaniu nie blokuje kolejki
+void test_03_failed_push() {
+    std::clog << "[03] failed push is skipped\n";
+    cxx::ingest_queue<int, fragile> q(4);
+    cxx::playlist<int, fragile> pl;
+    q.push(1, fragile(1));
+    fragile::fail = true;
+    bool thrown = false;
+    try {
+        q.push(2, fragile(2));
+    } catch (std::runtime_error const&) {
+        thrown = true;
+    }
+    fragile::fail = false;
+    assert(thrown);
+    q.push(3, fragile(3));
+    assert(q.drain(pl) == 3);
+    assert(pl.size() == 2);
+    assert(pl.front().second.value == 1);
+    pl.pop_front();
+    assert(pl.front().second.value == 3);
+}
+
+// 04: wielu producentów i konsument działający równolegle
+void test_04_stress() {
+    std::clog << "[04] producers and consumer stress\n";
+    constexpr unsigned producers = 8;
+    constexpr unsigned per_producer = 5000;
+    queue_t q(64);
+    playlist_t pl;
+    std::atomic<unsigned> done{0};
+
+    std::thread consumer([&] {
+        while (done.load() < producers) {
+            if (q.drain(pl, 32) == 0) {
+                std::this_thread::yield();
+            }
+        }
+        q.drain(pl);
+    });
+    std::vector<std::thread> threads;
+    for (unsigned p = 0; p < producers; ++p) {
+        threads.emplace_back([&, p] {
+            for (unsigned i = 0; i < per_producer; ++i) {
+                q.push("t" + std::to_string(i % 7), {p, i});
+            }
+            ++done;
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    consumer.join();
+
+    assert(pl.size() == producers * per_producer);
+    std::vector<unsigned> next(producers, 0);
+    for (auto const& [p, i] : played(pl)) {
+        assert(i == next[p]);
+        ++next[p];
+    }
+}
+
+// ======================== main ========================
+
+int main() {
+    try {
+        test_01_single_producer();
+        test_02_drain_into_shared();
+        test_03_failed_push();
+        test_04_stress();
+    } catch (...) {
+        assert(false && "Uncaught exception in tests");
+    }
+
+    std::clog << "ALL INGEST QUEUE TESTS PASSED\n";
+    return 0;
+}
@@ -0,0 +1,113 @@
+#include "playlist_stream.h"
+
+#ifdef NDEBUG
+#  undef NDEBUG
+#endif
+
+#include <cassert>
+#include <cstddef>
+#include <iostream>
+#include <ranges>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+// ======================== Narzędzia testowe ========================
+
+using playlist_t = cxx::playlist<std::string, int>;
+
+static playlist_t make_playlist(int n) {
+    playlist_t pl;
+    for (int i = 0; i < n; ++i) {
+        pl.push_back("t" + std::to_string(i % 7), i);
+    }
+    return pl;
+}
+
+// ======================== Testy ========================
+
+// 01: play_stream zwraca to samo co pętla po play_begin()/play_end()
+void test_01_play_stream() {
+    std::clog << "[01] play_stream matches play order\n";
+    for (int n : {0, 1, 15, 16, 17, 100}) {
+        playlist_t pl = make_playlist(n);
+        for (size_t chunk : {0u, 1u, 4u, 16u}) {
+            auto it = pl.play_begin();
+            int count = 0;
+            for (auto [track, params] : cxx::play_stream(pl, chunk)) {
+                assert(it != pl.play_end());
+                assert(&track == &pl.play(it).first);
+                assert(&params == &pl.play(it).second);
+                ++it;
+                ++count;
+            }
+            assert(count == n && it == pl.play_end());
+        }
+    }
+}
+
+// 02: pay_stream zwraca to samo co pętla po sorted_begin()/sorted_end()
+void test_02_pay_stream() {
+    std::clog << "[02] pay_stream matches sorted order\n";
+    playlist_t pl = make_playlist(50);
+    auto it = pl.sorted_begin();
+    for (auto [track, count] : cxx::pay_stream(pl)) {
+        assert(track == pl.pay(it).first);
+        assert(count == pl.pay(it).second);
+        ++it;
+    }
+    assert(it == pl.sorted_end());
+}
+
+// 03: strumień trzyma dane, zmiany oryginału ich nie dotykają
+void test_03_stream_outlives_changes() {
+    std::clog << "[03] stream keeps its data\n";
+    playlist_t pl = make_playlist(10);
+    auto stream = cxx::play_stream(pl);
+    auto it = stream.begin();
+    pl.clear();
+    pl.push_back("new", 99);
+    int expected = 0;
+    for (; it != stream.end(); ++it) {
+        assert((*it).second == expected);
+        ++expected;
+    }
+    assert(expected == 10);
+
+    // Tymczasowa playlista w wyrażeniu zakresu.
+    int sum = 0;
+    for (auto [track, params] : cxx::play_stream(make_playlist(5))) {
+        sum += params;
+    }
+    assert(sum == 10);
+}
+
+// 04: strumienie łączą się z widokami zakresów
+void test_04_ranges() {
+    std::clog << "[04] streams compose with views\n";
+    playlist_t pl = make_playlist(30);
+    std::vector<int> firsts;
+    for (int params : cxx::play_stream(pl) |
+             std::views::filter([](auto const& e) { return e.first == "t3"; }) |
+             std::views::transform([](auto const& e) { return e.second; })) {
+        firsts.push_back(params);
+    }
+    assert((firsts == std::vector<int>{3, 10, 17, 24}));
+}
+
+// ======================== main ========================
+
+int main() {
+    try {
+        test_01_play_stream();
+        test_02_pay_stream();
+        test_03_stream_outlives_changes();
+        test_04_ranges();
+    } catch (...) {
+        assert(false && "Uncaught exception in tests");
+    }
+
+    std::clog << "ALL STREAM TESTS PASSED\n";
+    return 0;
+}
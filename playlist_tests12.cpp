@@ -0,0 +1,162 @@
+#include "playlist_columns.h"
+
+#ifdef NDEBUG
+#  undef NDEBUG
+#endif
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <span>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+// ======================== Narzędzia testowe ========================
+
+// {początek, koniec} jak w playlist_example.cpp
+using params_t = std::pair<unsigned, unsigned>;
+using playlist_t = cxx::playlist<std::string, params_t>;
+using u32 = std::uint32_t;
+
+// Referencyjne wyniki liczone wprost.
+struct reference {
+    std::vector<u32> rows;
+    std::uint64_t sum = 0;
+    u32 lo = std::numeric_limits<u32>::max(), hi = 0;
+
+    reference(std::span<u32 const> values, u32 threshold) {
+        for (std::size_t i = 0; i < values.size(); ++i) {
+            if (values[i] > threshold) {
+                rows.push_back(static_cast<u32>(i));
+            }
+            sum += values[i];
+            lo = values[i] < lo ? values[i] : lo;
+            hi = values[i] > hi ? values[i] : hi;
+        }
+    }
+};
+
+template <typename Kernels>
+static void check_kernels(std::span<u32 const> values, u32 threshold) {
+    reference ref(values, threshold);
+    std::vector<u32> rows(values.size());
+    std::size_t found = Kernels::select_greater(values.data(), values.size(),
+                                                threshold, rows.data());
+    rows.resize(found);
+    assert(rows == ref.rows);
+    assert(Kernels::count_greater(values.data(), values.size(), threshold) ==
+           ref.rows.size());
+    assert(Kernels::sum(values.data(), values.size()) == ref.sum);
+    auto [lo, hi] = Kernels::min_max(values.data(), values.size());
+    assert(lo == ref.lo && hi == ref.hi);
+}
+
+// ======================== Testy ========================
+
+// 01: eksport do kolumn w kolejności odtwarzania
+void test_01_to_columns() {
+    std::clog << "[01] to_columns\n";
+    playlist_t empty;
+    auto none = cxx::to_columns(empty);
+    assert(none.size() == 0 && none.tracks.empty());
+
+    playlist_t pl;
+    pl.push_back("b", {0, 200});
+    pl.push_back("a", {200, 300});
+    pl.push_back("b", {300, 700});
+    pl.push_back("c", {700, 710});
+    auto cols = cxx::to_columns(pl);
+
+    assert((cols.tracks == std::vector<std::string>{"a", "b", "c"}));
+    assert(cols.size() == 4);
+    std::vector<u32> ids(cols.track_ids.begin(), cols.track_ids.end());
+    assert((ids == std::vector<u32>{1, 0, 1, 2}));
+    auto start = cols.field<0>();
+    auto end = cols.field<1>();
+    assert(start.size() == 4 && end[2] == 700 && start[3] == 700);
+    assert(reinterpret_cast<std::uintptr_t>(start.data()) % 64 == 0);
+    assert(reinterpret_cast<std::uintptr_t>(end.data()) % 64 == 0);
+
+    // Filtr z przykładu: utwory dłuższe niż 180 s.
+    cxx::column<u32> length(cols.size());
+    cxx::column_difference(end, start, length);
+    auto rows = cxx::column_select_greater(length, 180);
+    assert((rows == std::vector<u32>{0, 2}));
+    assert(cxx::column_count_greater(length, 180) == 2);
+    assert(cxx::column_sum(length) == 710);
+    assert(cxx::column_min_max(length) == std::make_pair(10u, 400u));
+}
+
+// 02: jednoelementowe parametry i krotki
+void test_02_other_params() {
+    std::clog << "[02] arithmetic and tuple params\n";
+    cxx::playlist<int, double> scalar;
+    scalar.push_back(3, 1.5);
+    scalar.push_back(1, 2.5);
+    auto a = cxx::to_columns(scalar);
+    assert(a.field<0>()[1] == 2.5 && a.track_ids[0] == 1);
+
+    cxx::playlist<int, std::tuple<u32, float, char>> tuples;
+    tuples.push_back(7, {1, 0.5f, 'x'});
+    auto b = cxx::to_columns(tuples);
+    assert(b.field<0>()[0] == 1 && b.field<1>()[0] == 0.5f &&
+           b.field<2>()[0] == 'x');
+}
+
+// 03: jądra SSE2/AVX2 zgodne z wersją skalarną na losowych danych
+void test_03_kernels_random() {
+    std::clog << "[03] kernels against reference\n";
+    std::mt19937 rng(45);
+    std::vector<u32> data(300);
+    for (auto& v : data) {
+        v = rng();
+    }
+    data[17] = 0;
+    data[42] = std::numeric_limits<u32>::max();
+    data[43] = 0x80000000u;
+
+    for (std::size_t offset : {0u, 1u, 3u, 5u}) {
+        for (std::size_t n : {0u, 1u, 3u, 4u, 7u, 8u, 9u, 31u, 64u, 250u}) {
+            std::span<u32 const> values(data.data() + offset, n);
+            for (u32 threshold : {0u, 1u, 0x7fffffffu, 0x80000000u,
+                                  0xfffffffeu, 0xffffffffu}) {
+                check_kernels<cxx::simd::scalar>(values, threshold);
+                check_kernels<cxx::simd::sse2>(values, threshold);
+                if (cxx::simd::has_avx2()) {
+                    check_kernels<cxx::simd::avx2>(values, threshold);
+                }
+                reference ref(values, threshold);
+                assert(cxx::column_count_greater(values, threshold) ==
+                       ref.rows.size());
+            }
+        }
+    }
+
+    std::vector<u32> hi(data.begin(), data.begin() + 37);
+    std::vector<u32> lo(data.begin() + 100, data.begin() + 137);
+    std::vector<u32> out(37);
+    cxx::column_difference(hi, lo, out);
+    for (std::size_t i = 0; i < out.size(); ++i) {
+        assert(out[i] == hi[i] - lo[i]);
+    }
+}
+
+// ======================== main ========================
+
+int main() {
+    try {
+        test_01_to_columns();
+        test_02_other_params();
+        test_03_kernels_random();
+    } catch (...) {
+        assert(false && "Uncaught exception in tests");
+    }
+
+    std::clog << "ALL COLUMN TESTS PASSED\n";
+    return 0;
+}
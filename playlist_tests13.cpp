@@ -0,0 +1,246 @@
+#define CXX_PLAYLIST_STATS
+#include "undo_playlist.h"
+
+#ifdef NDEBUG
+#  undef NDEBUG
+#endif
+
+#include <cassert>
+#include <cstddef>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+// ======================== Narzędzia testowe ========================
+
+using undo_t = cxx::undo_playlist<std::string, int>;
+using playlist_t = cxx::playlist<std::string, int>;
+using state_t = std::vector<std::pair<std::string, int>>;
+
+static state_t contents(playlist_t const& pl) {
+    state_t out;
+    for (auto [track, params] : pl.play_view()) {
+        out.emplace_back(track, params);
+    }
+    return out;
+}
+
+// Sprawdza również indeks posortowany (liczności utworów).
+static void check_state(undo_t const& u, state_t const& expected) {
+    assert(contents(u.get()) == expected);
+    std::size_t total = 0;
+    for (auto it = u.get().sorted_begin(); it != u.get().sorted_end(); ++it) {
+        total += u.get().pay(it).second;
+    }
+    assert(total == expected.size());
+}
+
+// ======================== Testy ========================
+
+// 01: cofanie i ponawianie każdej operacji
+void test_01_each_operation() {
+    std::clog << "[01] undo and redo of each operation\n";
+    undo_t u;
+    assert(!u.can_undo() && !u.can_redo());
+    u.push_back("a", 1);
+    u.push_back("b", 2);
+    u.push_back("a", 3);
+    u.push_back("c", 4);
+    state_t full = contents(u.get());
+
+    u.remove("a");
+    assert((contents(u.get()) == state_t{{"b", 2}, {"c", 4}}));
+    u.undo();
+    check_state(u, full);
+    u.redo();
+    assert((contents(u.get()) == state_t{{"b", 2}, {"c", 4}}));
+    u.undo();
+
+    u.pop_front();
+    u.undo();
+    check_state(u, full);
+
+    u.clear();
+    assert(u.get().size() == 0);
+    u.undo();
+    check_state(u, full);
+    u.redo();
+    assert(u.get().size() == 0);
+    u.undo();
+    check_state(u, full);
+
+    for (int i = 0; i < 4; ++i) {
+        u.undo();
+    }
+    assert(u.get().size() == 0 && !u.can_undo());
+    for (int i = 0; i < 4; ++i) {
+        u.redo();
+    }
+    check_state(u, full);
+    assert(u.can_redo());
+    u.push_back("d", 5);
+    assert(!u.can_redo());
+}
+
+// 02: błędy nie zmieniają historii
+void test_02_errors() {
+    std::clog << "[02] errors leave history unchanged\n";
+    undo_t u;
+    bool thrown = false;
+    try {
+        u.undo();
+    } catch (std::out_of_range const&) {
+        thrown = true;
+    }
+    assert(thrown);
+    thrown = false;
+    try {
+        u.pop_front();
+    } catch (std::out_of_range const&) {
+        thrown = true;
+    }
+    assert(thrown);
+    u.push_back("a", 1);
+    thrown = false;
+    try {
+        u.remove("x");
+    } catch (std::invalid_argument const&) {
+        thrown = true;
+    }
+    assert(thrown);
+    u.undo();
+    assert(!u.can_undo() && u.get().size() == 0);
+    thrown = false;
+    try {
+        u.undo();
+    } catch (std::out_of_range const&) {
+        thrown = true;
+    }
+    assert(thrown);
+}
+
+// 03: historia jest ograniczona liczbą wpisów
+void test_03_history_limit() {
+    std::clog << "[03] bounded history\n";
+    undo_t u(5);
+    for (int i = 0; i < 30; ++i) {
+        u.push_back("t" + std::to_string(i % 3), i);
+    }
+    assert(u.history_entries() == 5);
+    for (int i = 0; i < 5; ++i) {
+        u.undo();
+    }
+    assert(!u.can_undo() && u.get().size() == 25);
+
+    // Usunięcie większe niż limit nie da się cofnąć.
+    u.remove("t0");
+    assert(!u.can_undo() && u.history_entries() == 0);
+
+    // Cofnięte wyczyszczenie, porzucone przez nową zmianę, schodzi z licznika.
+    undo_t v(1000);
+    for (int i = 0; i < 30; ++i) {
+        v.push_back("t" + std::to_string(i % 3), i);
+    }
+    for (int round = 0; round < 5; ++round) {
+        v.clear();
+        v.undo();
+        v.push_back("x", round);
+    }
+    while (v.can_undo()) {
+        v.undo();
+    }
+    v.push_back("y", 0);
+    assert(v.history_entries() == 1);
+
+    undo_t w(100);
+    for (int i = 0; i < 42; ++i) {
+        w.push_back("t" + std::to_string(i % 3), i);
+    }
+    for (int round = 0; round < 3; ++round) {
+        w.clear();
+        w.undo();
+        w.push_back("x", round);
+    }
+    w.clear();
+    assert(w.can_undo());
+    w.undo();
+    assert(w.get().size() == 45);
+}
+
+// 04: losowe operacje, cofanie i ponawianie względem zapamiętanych stanów
+void test_04_random() {
+    std::clog << "[04] random edits against saved states\n";
+    std::mt19937 rng(46);
+    undo_t u;
+    std::vector<state_t> history{{}};
+    std::size_t current = 0;
+    for (int step = 0; step < 2000; ++step) {
+        unsigned choice = rng() % 10;
+        if (choice < 2 && u.can_undo()) {
+            u.undo();
+            --current;
+        } else if (choice < 3 && u.can_redo()) {
+            u.redo();
+            ++current;
+        } else {
+            std::string track = "t" + std::to_string(rng() % 6);
+            if (choice < 6) {
+                u.push_back(track, step);
+            } else if (choice < 8 && u.get().size() > 0) {
+                u.pop_front();
+            } else if (choice < 9 && u.get().size() > 0) {
+                u.remove(u.get().front().first);
+            } else if (rng() % 8 == 0) {
+                u.clear();
+            } else {
+                u.push_back(track, -step);
+            }
+            history.resize(current + 1);
+            history.push_back(contents(u.get()));
+            ++current;
+        }
+        check_state(u, history[current]);
+    }
+}
+
+// 05: edycje, cofanie i ponawianie bez głębokich kopii
+void test_05_no_deep_copies() {
+    std::clog << "[05] no deep copies\n";
+    undo_t u;
+    for (int i = 0; i < 100; ++i) {
+        u.push_back("t" + std::to_string(i % 10), i);
+    }
+    cxx::playlist_stats::reset();
+    u.remove("t3");
+    u.pop_front();
+    u.clear();
+    u.undo();
+    u.undo();
+    u.undo();
+    u.redo();
+    u.redo();
+    u.redo();
+    u.undo();
+    u.push_back("x", 0);
+    assert(cxx::playlist_stats::global().deep_copies == 0);
+}
+
+// ======================== main ========================
+
+int main() {
+    try {
+        test_01_each_operation();
+        test_02_errors();
+        test_03_history_limit();
+        test_04_random();
+        test_05_no_deep_copies();
+    } catch (...) {
+        assert(false && "Uncaught exception in tests");
+    }
+
+    std::clog << "ALL UNDO TESTS PASSED\n";
+    return 0;
+}
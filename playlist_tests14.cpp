@@ -0,0 +1,227 @@
+#define CXX_PLAYLIST_CHECKED_ITERATORS
+#include "playlist.h"
+
+#ifdef NDEBUG
+#  undef NDEBUG
+#endif
+
+#include <cassert>
+#include <cstddef>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// ======================== Narzędzia testowe ========================
+
+using playlist_t = cxx::playlist<std::string, int>;
+
+static playlist_t make(int n) {
+    playlist_t pl;
+    for (int i = 0; i < n; ++i) {
+        pl.push_back("t" + std::to_string(i % 3), i);
+    }
+    return pl;
+}
+
+static std::size_t position(playlist_t const& pl, playlist_t::play_iterator it) {
+    return static_cast<std::size_t>(std::distance(pl.play_begin(), it));
+}
+
+// ======================== Testy ========================
+
+// 01: odłączenie danych unieważnia iteratory, rebind wraca na to samo miejsce
+void test_01_detach() {
+    std::clog << "[01] detach makes iterators stale\n";
+    playlist_t pl = make(10);
+    auto it = std::next(pl.play_begin(), 4);
+    auto end = pl.play_end();
+    assert(pl.valid(it) && pl.valid(end));
+
+    playlist_t copy = pl;
+    pl.push_back("x", 100);
+    assert(!pl.valid(it) && !pl.valid(end));
+    assert(copy.valid(it));
+
+    auto fresh = pl.rebind(it);
+    assert(pl.valid(fresh));
+    assert(pl.play(fresh).second == 4);
+    assert(position(pl, fresh) == 4);
+    assert(pl.rebind(end) == pl.play_end());
+
+    // Dodanie bez kopii nie unieważnia iteratorów.
+    pl.push_back("y", 101);
+    pl.insert(pl.play_begin(), "z", -1);
+    assert(pl.valid(fresh));
+    assert(pl.play(fresh).second == 4);
+}
+
+// 02: usunięcie wpisu w miejscu unieważnia iteratory
+void test_02_unlinked_entries() {
+    std::clog << "[02] entries removed in place\n";
+    playlist_t pl = make(10);
+    auto it = std::next(pl.play_begin(), 5);
+    pl.pop_front();
+    assert(!pl.valid(it));
+    auto fresh = pl.rebind(it);
+    assert(pl.play(fresh).second == 5 && position(pl, fresh) == 4);
+
+    // Usunięty wpis zastępuje następny.
+    auto gone = std::next(pl.play_begin(), 2);
+    int after = pl.play(std::next(gone)).second;
+    pl.erase(std::next(pl.play_begin(), 2));
+    assert(pl.play(pl.rebind(gone)).second == after);
+
+    // Iterator w porządku posortowanym wraca na swój utwór, a po jego
+    // usunięciu na następny.
+    auto first = pl.sorted_begin();
+    auto sorted = std::next(first);
+    auto last = std::next(sorted);
+    pl.remove("t0");
+    assert(!pl.valid(sorted));
+    assert(*pl.rebind(sorted) == "t1");
+    assert(*pl.rebind(last) == "t2");
+    assert(*pl.rebind(first) == "t1");
+    pl.remove("t2");
+    assert(pl.rebind(last) == pl.sorted_end());
+
+    playlist_t letters;
+    for (char const* track : {"a", "b", "c", "d"}) {
+        letters.push_back(track, 0);
+    }
+    auto c = std::next(letters.sorted_begin(), 2);
+    auto end = letters.sorted_end();
+    letters.remove("a");
+    assert(*letters.rebind(c) == "c");
+    assert(letters.rebind(end) == letters.sorted_end());
+
+    pl.clear();
+    assert(!pl.valid(fresh));
+    assert(pl.rebind(fresh) == pl.play_end());
+}
+
+// 03: operacje zmieniające rzucają wyjątek dla nieaktualnego iteratora
+void test_03_stale_use_throws() {
+    std::clog << "[03] stale iterators are rejected\n";
+    playlist_t pl = make(6);
+    auto it = std::next(pl.play_begin(), 2);
+    playlist_t copy = pl;
+    pl.params(pl.play_begin()) = 7;
+    assert(!pl.valid(it));
+
+    bool thrown = false;
+    try {
+        pl.erase(it);
+    } catch (std::invalid_argument const&) {
+        thrown = true;
+    }
+    assert(thrown && pl.size() == 6);
+
+    thrown = false;
+    try {
+        pl.insert(it, "x", 0);
+    } catch (std::invalid_argument const&) {
+        thrown = true;
+    }
+    assert(thrown && pl.size() == 6);
+
+    thrown = false;
+    try {
+        pl.update_params(it, [](int& p) { p = 0; });
+    } catch (std::invalid_argument const&) {
+        thrown = true;
+    }
+    assert(thrown);
+
+    auto next = pl.erase(pl.rebind(it));
+    assert(pl.valid(next) && pl.play(next).second == 3);
+    assert(copy.size() == 6 && copy.play(it).second == 2);
+}
+
+// 04: po przenumerowaniu etykiet wpis odnajduje się po identyfikatorze
+void test_04_relabel() {
+    std::clog << "[04] rebind after relabelling\n";
+    playlist_t pl = make(4);
+    auto it = std::next(pl.play_begin(), 3);
+    // Iterator z find() nie zna swojej pozycji.
+    auto found = pl.find(pl.id(std::next(pl.play_begin(), 2)));
+    auto gone = std::next(pl.play_begin(), 1);
+    playlist_t copy = pl;
+    // Wstawianie w to samo miejsce wyczerpuje odstępy między etykietami.
+    auto pos = std::next(pl.play_begin());
+    for (int i = 0; i < 40; ++i) {
+        pos = pl.insert(pos, "r", 1000 + i);
+    }
+    assert(!pl.valid(it) && !pl.valid(found));
+    auto fresh = pl.rebind(it);
+    assert(pl.valid(fresh) && pl.play(fresh).second == 3);
+    assert(position(pl, fresh) == 43);
+    assert(pl.play(pl.rebind(found)).second == 2);
+
+    // Wpis usunięty po przenumerowaniu zastępuje ten na jego pozycji.
+    pl.erase(pl.rebind(gone));
+    assert(pl.play(pl.rebind(gone)).second == 1039);
+}
+
+// 05: losowe operacje – rebind zgadza się z wyszukiwaniem liniowym
+void test_05_random() {
+    std::clog << "[05] random operations against a linear search\n";
+    std::mt19937 rng(47);
+    playlist_t pl = make(50);
+    int next_value = 50;
+    for (int round = 0; round < 500; ++round) {
+        if (pl.size() == 0) {
+            pl = make(20);
+        }
+        std::size_t at = rng() % pl.size();
+        auto it = std::next(pl.play_begin(), static_cast<std::ptrdiff_t>(at));
+        playlist_t copy = pl;
+
+        switch (rng() % 4) {
+        case 0:
+            pl.push_back("t" + std::to_string(rng() % 5), next_value++);
+            break;
+        case 1:
+            pl.insert(std::next(pl.play_begin(),
+                static_cast<std::ptrdiff_t>(rng() % pl.size())), "n", next_value++);
+            break;
+        case 2:
+            pl.pop_front();
+            break;
+        default:
+            pl.erase(pl.rebind(it));
+            break;
+        }
+
+        // Pierwszy wpis, który w kopii był pod iteratorem lub za nim.
+        std::set<int> tail;
+        for (auto c = it; c != copy.play_end(); ++c) {
+            tail.insert(copy.play(c).second);
+        }
+        auto expected = pl.play_begin();
+        while (expected != pl.play_end() && !tail.contains(pl.play(expected).second)) {
+            ++expected;
+        }
+        assert(pl.rebind(it) == expected);
+    }
+}
+
+// ======================== main ========================
+
+int main() {
+    try {
+        test_01_detach();
+        test_02_unlinked_entries();
+        test_03_stale_use_throws();
+        test_04_relabel();
+        test_05_random();
+    } catch (...) {
+        assert(false && "Uncaught exception in tests");
+    }
+
+    std::clog << "ALL CHECKED ITERATOR TESTS PASSED\n";
+    return 0;
+}
@@ -0,0 +1,189 @@
+#include "playlist.h"
+
+#ifdef NDEBUG
+#  undef NDEBUG
+#endif
+
+#include <cassert>
+#include <cstddef>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+// ======================== Narzędzia testowe ========================
+
+using playlist_t = cxx::playlist<std::string, int>;
+using entry_id_t = playlist_t::entry_id;
+
+static std::vector<entry_id_t> ids(playlist_t const& pl) {
+    std::vector<entry_id_t> out;
+    for (auto it = pl.play_begin(); it != pl.play_end(); ++it) {
+        out.push_back(pl.id(it));
+    }
+    return out;
+}
+
+// ======================== Testy ========================
+
+// 01: identyfikatory są unikalne i rosną z kolejnymi wpisami
+void test_01_unique_ids() {
+    std::clog << "[01] ids are unique and growing\n";
+    playlist_t pl;
+    for (int i = 0; i < 10; ++i) {
+        pl.push_back("t" + std::to_string(i % 3), i);
+    }
+    auto all = ids(pl);
+    for (std::size_t i = 1; i < all.size(); ++i) {
+        assert(all[i - 1] < all[i]);
+    }
+    auto it = pl.insert(std::next(pl.play_begin(), 3), "x", 100);
+    assert(pl.id(it) > all.back());
+
+    playlist_t other;
+    other.push_back("t0", 0);
+    assert(pl.id(it) < other.id(other.play_begin()));
+
+    for (auto entry = pl.play_begin(); entry != pl.play_end(); ++entry) {
+        assert(pl.find(pl.id(entry)) == entry);
+    }
+    assert(pl.find(0) == pl.play_end());
+    assert(playlist_t().find(1) == playlist_t().play_end());
+}
+
+// 02: identyfikator przeżywa kopię przy zapisie
+void test_02_survives_detach() {
+    std::clog << "[02] ids survive copy-on-write\n";
+    playlist_t pl;
+    for (int i = 0; i < 20; ++i) {
+        pl.push_back("t" + std::to_string(i % 4), i);
+    }
+    entry_id_t held = pl.id(std::next(pl.play_begin(), 7));
+
+    playlist_t snapshot = pl;
+    pl.pop_front();
+    pl.push_back("y", 50);
+    pl.params(pl.play_begin()) = -1;
+    assert(pl.params(pl.find(held)) == 7);
+    assert(snapshot.params(snapshot.find(held)) == 7);
+    assert(ids(snapshot).size() == 20);
+
+    // Kopie rozchodzą się, ale nowe wpisy dostają różne identyfikatory.
+    playlist_t branch = snapshot;
+    branch.push_back("b", 60);
+    snapshot.push_back("s", 61);
+    entry_id_t in_branch = branch.id(std::prev(branch.play_end()));
+    entry_id_t in_snapshot = snapshot.id(std::prev(snapshot.play_end()));
+    assert(in_branch != in_snapshot);
+    assert(snapshot.find(in_branch) == snapshot.play_end());
+    assert(branch.find(in_snapshot) == branch.play_end());
+
+    pl.remove("t3");
+    assert(pl.find(held) == pl.play_end());
+    assert(snapshot.params(snapshot.find(held)) == 7);
+}
+
+// 03: operacje w miejscu – usunięte wpisy nie są znajdowane
+void test_03_in_place_changes() {
+    std::clog << "[03] in-place changes\n";
+    playlist_t pl(5);
+    for (int i = 0; i < 5; ++i) {
+        pl.push_back("t" + std::to_string(i), i);
+    }
+    auto before = ids(pl);
+    assert(pl.find(before[0]) == pl.play_begin());
+
+    // Pełna lista ograniczona używa węzła pierwszego wpisu ponownie.
+    pl.push_back("t9", 9);
+    assert(pl.find(before[0]) == pl.play_end());
+    assert(pl.params(pl.find(before[1])) == 1);
+    assert(pl.params(pl.find(pl.id(std::prev(pl.play_end())))) == 9);
+
+    pl.erase(pl.find(before[2]));
+    assert(pl.find(before[2]) == pl.play_end());
+    assert(pl.params(pl.find(before[3])) == 3);
+
+    pl.clear();
+    assert(pl.find(before[3]) == pl.play_end());
+}
+
+// 04: losowe operacje na kilku kopiach wobec mapy wzorcowej
+void test_04_random() {
+    std::clog << "[04] random operations against a reference\n";
+    std::mt19937 rng(48);
+    std::vector<playlist_t> copies(3);
+    std::vector<std::map<entry_id_t, int>> expected(3);
+    int next_value = 0;
+    for (int round = 0; round < 3000; ++round) {
+        std::size_t c = rng() % copies.size();
+        playlist_t& pl = copies[c];
+        switch (rng() % 6) {
+        case 0:
+        case 1:
+            pl.push_back("t" + std::to_string(rng() % 7), next_value);
+            expected[c][pl.id(std::prev(pl.play_end()))] = next_value++;
+            break;
+        case 2:
+            if (pl.size() > 0) {
+                auto pos = std::next(pl.play_begin(),
+                    static_cast<std::ptrdiff_t>(rng() % pl.size()));
+                expected[c].erase(pl.id(pos));
+                pl.erase(pos);
+            }
+            break;
+        case 3:
+            if (pl.size() > 0) {
+                expected[c].erase(pl.id(pl.play_begin()));
+                pl.pop_front();
+            }
+            break;
+        case 4: {
+            std::size_t from = rng() % copies.size();
+            copies[c] = copies[from];
+            expected[c] = expected[from];
+            break;
+        }
+        default:
+            if (pl.size() > 0 && rng() % 8 == 0) {
+                std::string track = pl.play(pl.play_begin()).first;
+                for (auto it = pl.play_begin(); it != pl.play_end(); ++it) {
+                    if (pl.play(it).first == track) {
+                        expected[c].erase(pl.id(it));
+                    }
+                }
+                pl.remove(track);
+            }
+            break;
+        }
+
+        for (std::size_t k = 0; k < copies.size(); ++k) {
+            assert(copies[k].size() == expected[k].size());
+            for (auto const& [entry, value] : expected[k]) {
+                auto it = copies[k].find(entry);
+                assert(it != copies[k].play_end());
+                assert(copies[k].play(it).second == value);
+            }
+        }
+        entry_id_t probe = rng() % (static_cast<entry_id_t>(next_value) * 2 + 1);
+        bool present = expected[c].contains(probe);
+        assert((copies[c].find(probe) != copies[c].play_end()) == present);
+    }
+}
+
+// ======================== main ========================
+
+int main() {
+    try {
+        test_01_unique_ids();
+        test_02_survives_detach();
+        test_03_in_place_changes();
+        test_04_random();
+    } catch (...) {
+        assert(false && "Uncaught exception in tests");
+    }
+
+    std::clog << "ALL ENTRY ID TESTS PASSED\n";
+    return 0;
+}
@@ -0,0 +1,178 @@
+#define CXX_PLAYLIST_STATS
+#include "playlist.h"
+
+#ifdef NDEBUG
+#  undef NDEBUG
+#endif
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+// ======================== Narzędzia testowe ========================
+
+// {czas rozpoczęcia, stacja}
+using params_t = std::pair<int, char>;
+using playlist_t = cxx::playlist<std::string, params_t>;
+using entry_t = std::pair<std::string, params_t>;
+
+static std::vector<entry_t> contents(playlist_t const& pl) {
+    std::vector<entry_t> out;
+    for (auto [track, params] : pl.play_view()) {
+        out.emplace_back(track, params);
+    }
+    return out;
+}
+
+static std::map<std::string, std::size_t> counts(playlist_t const& pl) {
+    std::map<std::string, std::size_t> out;
+    for (auto [track, count] : pl.sorted_index()) {
+        out[track] = count;
+    }
+    return out;
+}
+
+static std::map<std::string, std::size_t> counts(std::vector<entry_t> const& entries) {
+    std::map<std::string, std::size_t> out;
+    for (auto const& [track, params] : entries) {
+        ++out[track];
+    }
+    return out;
+}
+
+static playlist_t station(std::vector<entry_t> const& entries) {
+    playlist_t pl;
+    for (auto const& [track, params] : entries) {
+        pl.push_back(track, params);
+    }
+    return pl;
+}
+
+// ======================== Testy ========================
+
+// 01: przeplot po czasie rozpoczęcia, przy remisie najpierw pierwsza lista
+void test_01_interleave() {
+    std::clog << "[01] interleave by start time\n";
+    playlist_t a = station({{"x", {0, 'a'}}, {"y", {10, 'a'}}, {"x", {20, 'a'}}});
+    playlist_t b = station({{"y", {5, 'b'}}, {"z", {10, 'b'}}, {"x", {30, 'b'}}});
+
+    auto m = cxx::merge_interleaved(a, b, &params_t::first);
+    std::vector<entry_t> expected = {{"x", {0, 'a'}}, {"y", {5, 'b'}},
+        {"y", {10, 'a'}}, {"z", {10, 'b'}}, {"x", {20, 'a'}}, {"x", {30, 'b'}}};
+    assert(contents(m) == expected);
+    assert(counts(m) == counts(expected));
+    assert(m.pay(m.sorted_begin()).second == 3);
+    assert(m.capacity() == 0);
+
+    // Wystąpienia utworu są w kolejności odtwarzania.
+    m.pop_front();
+    m.remove("y");
+    assert((contents(m) == std::vector<entry_t>{
+        {"z", {10, 'b'}}, {"x", {20, 'a'}}, {"x", {30, 'b'}}}));
+
+    // Porządek malejący podanym komparatorem.
+    playlist_t c = station({{"p", {9, 'c'}}, {"q", {1, 'c'}}});
+    playlist_t d = station({{"r", {5, 'd'}}});
+    auto desc = cxx::merge_interleaved(c, d, &params_t::first, std::greater<>{});
+    assert((contents(desc) == std::vector<entry_t>{
+        {"p", {9, 'c'}}, {"r", {5, 'd'}}, {"q", {1, 'c'}}}));
+}
+
+// 02: puste listy, scalanie z samym sobą, niezależność wyniku
+void test_02_edge_cases() {
+    std::clog << "[02] empty operands and independence\n";
+    playlist_t empty;
+    playlist_t a = station({{"x", {1, 'a'}}, {"y", {2, 'a'}}});
+    assert(cxx::merge_interleaved(empty, empty, &params_t::first).size() == 0);
+    assert(contents(cxx::merge_interleaved(a, empty, &params_t::first)) == contents(a));
+    assert(contents(cxx::merge_interleaved(empty, a, &params_t::first)) == contents(a));
+
+    auto twice = cxx::merge_interleaved(a, a, &params_t::first);
+    assert((contents(twice) == std::vector<entry_t>{
+        {"x", {1, 'a'}}, {"x", {1, 'a'}}, {"y", {2, 'a'}}, {"y", {2, 'a'}}}));
+    assert(twice.count("x") == 2);
+
+    // Wpisy wyniku są nowe: własne identyfikatory, brak współdzielenia.
+    std::vector<playlist_t::entry_id> ids;
+    for (auto it = twice.play_begin(); it != twice.play_end(); ++it) {
+        ids.push_back(twice.id(it));
+        assert(twice.find(ids.back()) == it);
+        assert(a.find(ids.back()) == a.play_end());
+    }
+    std::sort(ids.begin(), ids.end());
+    assert(std::adjacent_find(ids.begin(), ids.end()) == ids.end());
+
+    cxx::playlist_stats::reset();
+    twice.push_back("z", {3, 'a'});
+    twice.params(twice.play_begin()).first = -1;
+    assert(cxx::playlist_stats::global().deep_copies == 0);
+    assert(contents(a) == (std::vector<entry_t>{{"x", {1, 'a'}}, {"y", {2, 'a'}}}));
+
+    // Wstawianie w środek korzysta z równo rozłożonych etykiet.
+    auto pos = std::next(twice.play_begin(), 2);
+    pos = twice.insert(pos, "w", {1, 'w'});
+    assert(twice.play(std::prev(pos)).first == "x");
+    assert(twice.play(std::next(pos)).first == "y");
+}
+
+// 03: losowe stacje wobec std::merge
+void test_03_random() {
+    std::clog << "[03] random stations against std::merge\n";
+    std::mt19937 rng(49);
+    for (int round = 0; round < 200; ++round) {
+        std::vector<entry_t> left, right;
+        int time = 0;
+        for (std::size_t i = rng() % 40; i > 0; --i) {
+            time += static_cast<int>(rng() % 3);
+            left.push_back({"t" + std::to_string(rng() % 9), {time, 'a'}});
+        }
+        time = 0;
+        for (std::size_t i = rng() % 40; i > 0; --i) {
+            time += static_cast<int>(rng() % 3);
+            right.push_back({"t" + std::to_string(rng() % 12), {time, 'b'}});
+        }
+        std::vector<entry_t> expected;
+        std::merge(left.begin(), left.end(), right.begin(), right.end(),
+            std::back_inserter(expected), [](entry_t const& x, entry_t const& y) {
+                return x.second.first < y.second.first;
+            });
+
+        playlist_t a = station(left);
+        playlist_t b = station(right);
+        auto m = cxx::merge_interleaved(a, b, &params_t::first);
+        assert(contents(m) == expected);
+        assert(counts(m) == counts(expected));
+        assert(contents(a) == left && contents(b) == right);
+
+        // Usuwanie utworów po kolei zachowuje resztę w kolejności.
+        while (m.size() > 0) {
+            std::string track = m.play(m.play_begin()).first;
+            m.remove(track);
+            std::erase_if(expected, [&](entry_t const& e) { return e.first == track; });
+            assert(contents(m) == expected);
+        }
+    }
+}
+
+// ======================== main ========================
+
+int main() {
+    try {
+        test_01_interleave();
+        test_02_edge_cases();
+        test_03_random();
+    } catch (...) {
+        assert(false && "Uncaught exception in tests");
+    }
+
+    std::clog << "ALL MERGE TESTS PASSED\n";
+    return 0;
+}
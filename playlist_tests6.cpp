@@ -0,0 +1,296 @@
+#include "journaled_playlist.h"
+
+#ifdef NDEBUG
+#  undef NDEBUG
+#endif
+
+#include <cassert>
+#include <cstddef>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+// ======================== Narzędzia testowe ========================
+
+using params_t = std::pair<unsigned, unsigned>;
+using journal_t = cxx::journaled_playlist<std::string, params_t>;
+using playlist_t = cxx::playlist<std::string, params_t>;
+
+static std::string journal_path() {
+    return (std::filesystem::temp_directory_path() /
+            "playlist_tests6_journal.bin").string();
+}
+
+static void remove_journal() {
+    std::filesystem::remove(journal_path());
+    std::filesystem::remove(journal_path() + ".tmp");
+}
+
+static std::vector<std::pair<std::string, params_t>>
+contents(playlist_t const& pl) {
+    std::vector<std::pair<std::string, params_t>> out;
+    for (auto it = pl.play_begin(); it != pl.play_end(); ++it) {
+        auto [track, params] = pl.play(it);
+        out.emplace_back(track, params);
+    }
+    return out;
+}
+
+// ======================== Testy ========================
+
+// 01: append_range dodaje wszystko na koniec w kolejności
+void test_01_append_range() {
+    std::clog << "[01] append_range\n";
+    playlist_t pl;
+    pl.push_back("a", {0, 1});
+    std::vector<std::pair<std::string, params_t>> batch = {
+        {"b", {1, 2}}, {"a", {2, 3}}, {"c", {3, 4}}};
+    playlist_t copy = pl;
+    pl.append_range(batch);
+
+    assert(pl.size() == 4);
+    assert(copy.size() == 1);
+    assert(pl.pay(pl.sorted_begin()).second == 2);
+    auto items = contents(pl);
+    assert(items[1].first == "b" && items[3].first == "c");
+}
+
+// 02: operacje przetrwają zamknięcie i ponowne otwarcie dziennika
+void test_02_replay() {
+    std::clog << "[02] replay after reopen\n";
+    remove_journal();
+    std::vector<std::pair<std::string, params_t>> expected;
+    {
+        journal_t j(journal_path(), 4, 0);
+        j.push_back("one", {0, 10});
+        j.push_back("two", {10, 20});
+        j.push_back("one", {20, 30});
+        j.push_back("three", {30, 40});
+        j.pop_front();
+        j.remove("two");
+        j.push_back("four", {40, 50});
+        expected = contents(j.get());
+    }
+    journal_t j(journal_path(), 4, 0);
+    assert(contents(j.get()) == expected);
+    assert(j.get().size() == 3);
+}
+
+// 03: clear jest odtwarzany
+void test_03_replay_clear() {
+    std::clog << "[03] replay clear\n";
+    remove_journal();
+    {
+        journal_t j(journal_path());
+        j.push_back("x", {1, 1});
+        j.clear();
+        j.push_back("y", {2, 2});
+    }
+    journal_t j(journal_path());
+    assert(j.get().size() == 1);
+    assert(j.get().front().first == "y");
+}
+
+// 04: nieudana operacja nie trafia do dziennika
+void test_04_failed_operation_not_logged() {
+    std::clog << "[04] failed operations are not logged\n";
+    remove_journal();
+    {
+        journal_t j(journal_path(), 1, 0);
+        bool thrown = false;
+        try {
+            j.pop_front();
+        } catch (std::out_of_range const&) {
+            thrown = true;
+        }
+        assert(thrown);
+        thrown = false;
+        try {
+            j.remove("missing");
+        } catch (std::invalid_argument const&) {
+            thrown = true;
+        }
+        assert(thrown);
+        j.push_back("ok", {0, 0});
+    }
+    journal_t j(journal_path());
+    assert(j.get().size() == 1);
+}
+
+// 05: kompaktowanie zastępuje historię migawką
+void test_05_compaction() {
+    std::clog << "[05] compaction\n";
+    remove_journal();
+    std::vector<std::pair<std::string, params_t>> expected;
+    {
+        journal_t j(journal_path(), 8, 0);
+        for (unsigned i = 0; i < 200; ++i) {
+            j.push_back("t" + std::to_string(i % 7), {i, i + 1});
+        }
+        for (unsigned i = 0; i < 150; ++i) {
+            j.pop_front();
+        }
+        j.flush();
+        auto before = std::filesystem::file_size(journal_path());
+        j.compact();
+        auto after = std::filesystem::file_size(journal_path());
+        assert(after < before);
+        j.push_back("last", {7, 7});
+        expected = contents(j.get());
+    }
+    journal_t j(journal_path());
+    assert(contents(j.get()) == expected);
+    assert(j.get().size() == 51);
+}
+
+// 06: automatyczne kompaktowanie co compact_every rekordów
+void test_06_periodic_compaction() {
+    std::clog << "[06] periodic compaction\n";
+    remove_journal();
+    std::vector<std::pair<std::string, params_t>> expected;
+    {
+        journal_t j(journal_path(), 16, 32);
+        for (unsigned i = 0; i < 100; ++i) {
+            j.push_back("t" + std::to_string(i % 3), {i, i});
+            if (i % 2 == 1) {
+                j.pop_front();
+            }
+        }
+        expected = contents(j.get());
+    }
+    journal_t j(journal_path());
+    assert(contents(j.get()) == expected);
+}
+
+// 07: urwany ostatni rekord jest pomijany
+void test_07_torn_tail() {
+    std::clog << "[07] torn tail\n";
+    remove_journal();
+    {
+        journal_t j(journal_path(), 1, 0);
+        j.push_back("kept", {1, 2});
+        j.push_back("torn", {3, 4});
+    }
+    auto size = std::filesystem::file_size(journal_path());
+    std::filesystem::resize_file(journal_path(), size - 3);
+    {
+        journal_t j(journal_path(), 1, 0);
+        assert(j.get().size() == 1);
+        assert(j.get().front().first == "kept");
+        j.push_back("after", {5, 6});
+    }
+    journal_t j(journal_path());
+    assert(j.get().size() == 2);
+    remove_journal();
+}
+
+// 08: migawka kolumnowa (parametry jednym blokiem) i zwykła, także urwana
+void test_08_snapshot_layouts() {
+    std::clog << "[08] column and entry snapshots\n";
+    remove_journal();
+    using raw_t = cxx::journaled_playlist<int, params_t>;
+    std::vector<std::pair<int, params_t>> expected;
+    {
+        raw_t j(journal_path(), 8, 0);
+        for (unsigned i = 0; i < 300; ++i) {
+            j.push_back(static_cast<int>(i % 11), {i, 3 * i});
+        }
+        j.remove(4);
+        j.compact();
+        // 1 + 8 bajtów nagłówka, po 4 na utwór i 8 na parametry.
+        auto entries = j.get().size();
+        assert(std::filesystem::file_size(journal_path()) == 8 + 9 + entries * 12);
+        for (auto it = j.get().play_begin(); it != j.get().play_end(); ++it) {
+            expected.push_back(j.get().play(it));
+        }
+    }
+    {
+        raw_t j(journal_path());
+        std::vector<std::pair<int, params_t>> replayed;
+        for (auto it = j.get().play_begin(); it != j.get().play_end(); ++it) {
+            replayed.push_back(j.get().play(it));
+        }
+        assert(replayed == expected);
+    }
+
+    // Urwany blok parametrów: migawka jest pomijana w całości.
+    auto size = std::filesystem::file_size(journal_path());
+    std::filesystem::resize_file(journal_path(), size - 5);
+    {
+        raw_t j(journal_path());
+        assert(j.get().size() == 0);
+    }
+
+    // Parametry bez kodowania bajt po bajcie – migawka wpis po wpisie.
+    remove_journal();
+    using named_t = cxx::journaled_playlist<int, std::pair<std::string, unsigned>>;
+    {
+        named_t j(journal_path(), 8, 0);
+        for (unsigned i = 0; i < 50; ++i) {
+            j.push_back(static_cast<int>(i % 5), {"p" + std::to_string(i), i});
+        }
+        j.pop_front();
+        j.compact();
+    }
+    named_t j(journal_path());
+    assert(j.get().size() == 49);
+    assert(j.get().front().first == 1);
+    assert(j.get().play(j.get().play_begin()).second.first == "p1");
+    remove_journal();
+}
+
+// 09: plik krótszy niż nagłówek to nowy dziennik
+void test_09_short_header() {
+    std::clog << "[09] file shorter than the header\n";
+    remove_journal();
+    {
+        std::ofstream out(journal_path(), std::ios::binary);
+        out << "CXX";
+    }
+    {
+        journal_t j(journal_path(), 1, 0);
+        assert(j.get().size() == 0);
+        j.push_back("a", {1, 1});
+    }
+    {
+        journal_t j(journal_path());
+        assert(j.get().size() == 1);
+    }
+
+    // Pusty plik też.
+    std::filesystem::resize_file(journal_path(), 0);
+    {
+        journal_t j(journal_path(), 1, 0);
+        assert(j.get().size() == 0);
+        j.push_back("b", {2, 2});
+    }
+    journal_t j(journal_path());
+    assert(j.get().size() == 1 && j.get().front().first == "b");
+    remove_journal();
+}
+
+// ======================== main ========================
+
+int main() {
+    try {
+        test_01_append_range();
+        test_02_replay();
+        test_03_replay_clear();
+        test_04_failed_operation_not_logged();
+        test_05_compaction();
+        test_06_periodic_compaction();
+        test_07_torn_tail();
+        test_08_snapshot_layouts();
+        test_09_short_header();
+    } catch (...) {
+        assert(false && "Uncaught exception in tests");
+    }
+
+    std::clog << "ALL JOURNAL TESTS PASSED\n";
+    return 0;
+}
@@ -0,0 +1,995 @@
+#include "playlist.h"
+
+#ifdef NDEBUG
+#  undef NDEBUG
+#endif
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <numeric>
+#include <ranges>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// ======================== Narzędzia testowe ========================
+
+// Zakres wartości short używanych jako utwory w teście 20.
+template <>
+struct cxx::track_key_range<short> {
+    static constexpr bool bounded = true;
+    static constexpr std::int64_t min = -10;
+    static constexpr std::int64_t max = 99;
+};
+
+using playlist_t = cxx::playlist<std::string, int>;
+using model_t = std::deque<std::pair<std::string, int>>;
+
+// Porównuje plejlistę z modelem: kolejność odtwarzania, indeks i liczności.
+static void check_against(playlist_t const& pl, model_t const& model) {
+    assert(pl.size() == model.size());
+    auto it = pl.play_begin();
+    for (auto const& [track, params] : model) {
+        assert(it != pl.play_end());
+        assert(pl.play(it).first == track);
+        assert(pl.play(it).second == params);
+        ++it;
+    }
+    assert(it == pl.play_end());
+
+    std::map<std::string, std::size_t> counts;
+    for (auto const& item : model) {
+        ++counts[item.first];
+    }
+    auto sit = pl.sorted_begin();
+    for (auto const& [track, count] : counts) {
+        assert(sit != pl.sorted_end());
+        assert(pl.pay(sit).first == track);
+        assert(pl.pay(sit).second == count);
+        ++sit;
+    }
+    assert(sit == pl.sorted_end());
+}
+
+// ======================== Testy ========================
+
+// 01: ograniczona plejlista usuwa najstarsze wpisy
+void test_01_bounded_drops_oldest() {
+    std::clog << "[01] bounded playlist drops oldest\n";
+    playlist_t pl(3);
+    assert(pl.capacity() == 3);
+    model_t model;
+    for (int i = 0; i < 10; ++i) {
+        std::string track = "t" + std::to_string(i % 4);
+        pl.push_back(track, i);
+        model.emplace_back(track, i);
+        if (model.size() > 3) {
+            model.pop_front();
+        }
+        check_against(pl, model);
+    }
+}
+
+// 02: ten sam utwór, nowe utwory i znikające utwory
+void test_02_bounded_track_churn() {
+    std::clog << "[02] bounded playlist track churn\n";
+    playlist_t pl(4);
+    model_t model;
+    std::vector<std::string> tracks = {"a", "a", "b", "c", "a", "d", "e",
+                                       "e", "e", "e", "b", "a", "f", "a"};
+    int i = 0;
+    for (auto const& track : tracks) {
+        pl.push_back(track, i);
+        model.emplace_back(track, i++);
+        if (model.size() > 4) {
+            model.pop_front();
+        }
+        check_against(pl, model);
+    }
+    pl.pop_front();
+    model.pop_front();
+    pl.remove("a");
+    std::erase_if(model, [](auto const& item) { return item.first == "a"; });
+    check_against(pl, model);
+}
+
+// 03: kopie ograniczonej plejlisty nie wpływają na siebie
+void test_03_bounded_copy_on_write() {
+    std::clog << "[03] bounded copy on write\n";
+    playlist_t pl(2);
+    pl.push_back("x", 1);
+    pl.push_back("y", 2);
+    playlist_t copy = pl;
+    assert(copy.capacity() == 2);
+    pl.push_back("z", 3);
+    check_against(copy, {{"x", 1}, {"y", 2}});
+    check_against(pl, {{"y", 2}, {"z", 3}});
+    copy.push_back("x", 4);
+    check_against(copy, {{"y", 2}, {"x", 4}});
+
+    playlist_t unbounded;
+    unbounded = copy;
+    assert(unbounded.capacity() == 2);
+}
+
+// 04: append_range respektuje pojemność
+void test_04_bounded_append_range() {
+    std::clog << "[04] bounded append_range\n";
+    playlist_t pl(3);
+    std::vector<std::pair<std::string, int>> batch = {
+        {"a", 1}, {"b", 2}, {"c", 3}, {"d", 4}, {"a", 5}};
+    pl.append_range(batch);
+    check_against(pl, {{"c", 3}, {"d", 4}, {"a", 5}});
+}
+
+// 05: shuffle_view odwiedza każdy wpis dokładnie raz
+void test_05_shuffle_visits_each_once() {
+    std::clog << "[05] shuffle_view visits each entry once\n";
+    for (int n : {0, 1, 2, 3, 5, 16, 17, 1000}) {
+        playlist_t pl;
+        for (int i = 0; i < n; ++i) {
+            pl.push_back("t" + std::to_string(i % 7), i);
+        }
+        auto view = pl.shuffle_view(42);
+        assert(view.size() == static_cast<std::size_t>(n));
+        std::vector<int> seen(static_cast<std::size_t>(n), 0);
+        for (auto [track, params] : view) {
+            assert(track == "t" + std::to_string(params % 7));
+            ++seen[static_cast<std::size_t>(params)];
+        }
+        for (int count : seen) {
+            assert(count == 1);
+        }
+    }
+}
+
+// 06: ta sama wartość ziarna daje tę samą kolejność, inna - inną
+void test_06_shuffle_is_deterministic() {
+    std::clog << "[06] shuffle_view is deterministic\n";
+    playlist_t pl;
+    for (int i = 0; i < 100; ++i) {
+        pl.push_back("t", i);
+    }
+    auto order = [&](std::uint64_t seed) {
+        std::vector<int> out;
+        for (auto item : pl.shuffle_view(seed)) {
+            out.push_back(item.second);
+        }
+        return out;
+    };
+    assert(order(7) == order(7));
+    assert(order(7) != order(8));
+
+    std::vector<int> identity(100);
+    for (int i = 0; i < 100; ++i) {
+        identity[static_cast<std::size_t>(i)] = i;
+    }
+    assert(order(7) != identity);
+}
+
+// 07: widok po modyfikacji widzi aktualną zawartość
+void test_07_shuffle_after_modification() {
+    std::clog << "[07] shuffle_view after modification\n";
+    playlist_t pl;
+    for (int i = 0; i < 10; ++i) {
+        pl.push_back("t" + std::to_string(i), i);
+    }
+    playlist_t copy = pl;
+    (void)pl.shuffle_view(1);
+    pl.pop_front();
+    pl.remove("t5");
+    pl.push_back("new", 10);
+    int sum = 0;
+    for (auto item : pl.shuffle_view(1)) {
+        sum += item.second;
+    }
+    assert(sum == 45 - 0 - 5 + 10);
+    std::size_t count = 0;
+    for ([[maybe_unused]] auto item : copy.shuffle_view(1)) {
+        ++count;
+    }
+    assert(count == 10);
+}
+
+// Sprawdza, czy wystąpienia tego samego utworu są oddalone o więcej niż w.
+static void check_spacing(playlist_t const& pl, std::size_t w) {
+    std::map<std::string, std::size_t> last;
+    std::map<std::string, int> last_params;
+    std::size_t pos = 0;
+    for (auto it = pl.play_begin(); it != pl.play_end(); ++it, ++pos) {
+        auto [track, params] = pl.play(it);
+        auto found = last.find(track);
+        if (found != last.end()) {
+            assert(pos - found->second > w);
+            // Kolejność wystąpień utworu jest zachowana.
+            assert(last_params[track] < params);
+        }
+        last[track] = pos;
+        last_params[track] = params;
+    }
+}
+
+// 08: respace rozsuwa powtórzenia utworów
+void test_08_respace() {
+    std::clog << "[08] respace\n";
+    playlist_t pl;
+    std::vector<std::string> tracks = {"a", "a", "a", "b", "b", "c",
+                                       "a", "d", "b", "c", "e", "f"};
+    int i = 0;
+    for (auto const& t : tracks) {
+        pl.push_back(t, i++);
+    }
+    playlist_t copy = pl;
+
+    auto order = pl.spread_view(2);
+    assert(order.size() == pl.size());
+    pl.respace(2);
+    assert(pl.size() == tracks.size());
+    check_spacing(pl, 2);
+    std::size_t pos = 0;
+    for (auto it = pl.play_begin(); it != pl.play_end(); ++it, ++pos) {
+        assert(pl.play(it).second == copy.play(order[pos]).second);
+    }
+    assert(pl.pay(pl.sorted_begin()).second == 4);
+    assert(copy.front().second == 0);
+
+    pl.pop_front();
+    check_spacing(pl, 2);
+    pl.remove("b");
+    pl.respace(2);
+    check_spacing(pl, 2);
+}
+
+// 09: niemożliwe rozstawienie rzuca wyjątek i niczego nie zmienia
+void test_09_respace_impossible() {
+    std::clog << "[09] respace impossible\n";
+    playlist_t pl;
+    pl.push_back("a", 0);
+    pl.push_back("a", 1);
+    pl.push_back("b", 2);
+    playlist_t copy = pl;
+    bool thrown = false;
+    try {
+        pl.respace(2);
+    } catch (std::invalid_argument const&) {
+        thrown = true;
+    }
+    assert(thrown);
+    check_against(pl, {{"a", 0}, {"a", 1}, {"b", 2}});
+
+    thrown = false;
+    try {
+        (void)copy.spread_view(2);
+    } catch (std::invalid_argument const&) {
+        thrown = true;
+    }
+    assert(thrown);
+
+    copy.respace(1);
+    check_against(copy, {{"a", 0}, {"b", 2}, {"a", 1}});
+    check_against(pl, {{"a", 0}, {"a", 1}, {"b", 2}});
+}
+
+// 10: losowe plejlisty z dużą liczbą utworów
+void test_10_respace_random() {
+    std::clog << "[10] respace random\n";
+    unsigned state = 12345;
+    for (int round = 0; round < 50; ++round) {
+        playlist_t pl;
+        for (int i = 0; i < 200; ++i) {
+            state = state * 1103515245u + 12345u;
+            pl.push_back("t" + std::to_string((state >> 16) % 20), i);
+        }
+        pl.respace(3);
+        check_spacing(pl, 3);
+    }
+}
+
+// 11: pusta plejlista działa bez danych, małe plejlisty wielokrotnie
+void test_11_small_playlists() {
+    std::clog << "[11] many small playlists\n";
+    playlist_t empty;
+    assert(empty.size() == 0);
+    assert(empty.play_begin() == empty.play_end());
+    assert(empty.sorted_begin() == empty.sorted_end());
+    playlist_t empty_copy = empty;
+    empty.clear();
+    assert(empty_copy.size() == 0);
+
+    for (int round = 0; round < 1000; ++round) {
+        playlist_t pl;
+        for (int i = 0; i < round % 20; ++i) {
+            pl.push_back("t" + std::to_string(i % 3), i);
+        }
+        playlist_t copy = pl;
+        if (pl.size() > 0) {
+            pl.pop_front();
+            assert(copy.size() == pl.size() + 1);
+        }
+    }
+}
+
+// 12: plejlista utworzona w jednym wątku i zniszczona w innym
+void test_12_cross_thread_destruction() {
+    std::clog << "[12] cross-thread destruction\n";
+    std::vector<playlist_t> made(100);
+    std::thread producer([&made] {
+        for (std::size_t i = 0; i < made.size(); ++i) {
+            for (int j = 0; j < 10; ++j) {
+                made[i].push_back("t" + std::to_string(j), j);
+            }
+        }
+    });
+    producer.join();
+    for (auto& pl : made) {
+        assert(pl.size() == 10);
+        pl.pop_front();
+    }
+    made.clear();
+
+    playlist_t pl;
+    std::thread consumer([moved = std::move(pl)]() mutable {
+        moved.push_back("x", 1);
+    });
+    consumer.join();
+}
+
+// 13: pierwsza modyfikacja współdzielonych danych kopiuje tylko to, co zostaje
+void test_13_shared_first_write() {
+    std::clog << "[13] first write on shared data\n";
+    playlist_t base;
+    model_t model;
+    for (int i = 0; i < 30; ++i) {
+        std::string track = "t" + std::to_string(i % 5);
+        base.push_back(track, i);
+        model.emplace_back(track, i);
+    }
+
+    playlist_t popped = base;
+    popped.pop_front();
+    model_t popped_model(model.begin() + 1, model.end());
+    check_against(popped, popped_model);
+    check_against(base, model);
+
+    playlist_t removed = base;
+    removed.remove("t3");
+    model_t removed_model = model;
+    std::erase_if(removed_model,
+                  [](auto const& item) { return item.first == "t3"; });
+    check_against(removed, removed_model);
+    removed.remove("t0");
+    removed.pop_front();
+
+    playlist_t single;
+    single.push_back("only", 1);
+    playlist_t single_copy = single;
+    single_copy.pop_front();
+    assert(single_copy.size() == 0);
+    assert(single_copy.sorted_begin() == single_copy.sorted_end());
+    check_against(single, {{"only", 1}});
+
+    playlist_t edited = base;
+    auto it = edited.play_begin();
+    ++it;
+    ++it;
+    edited.params(it) = 100;
+    model_t edited_model = model;
+    edited_model[2].second = 100;
+    check_against(edited, edited_model);
+    check_against(base, model);
+}
+
+// 14: update_params nie psuje późniejszego współdzielenia
+void test_14_update_params() {
+    std::clog << "[14] update_params\n";
+    playlist_t base;
+    for (int i = 0; i < 5; ++i) {
+        base.push_back("t" + std::to_string(i), i);
+    }
+    playlist_t edited = base;
+    auto it = std::next(edited.play_begin(), 3);
+    edited.update_params(it, [](int& p) { p = 30; });
+    check_against(base, {{"t0", 0}, {"t1", 1}, {"t2", 2}, {"t3", 3}, {"t4", 4}});
+    check_against(edited, {{"t0", 0}, {"t1", 1}, {"t2", 2}, {"t3", 30}, {"t4", 4}});
+
+    // Dane nie są już współdzielone, więc edycja odbywa się w miejscu.
+    edited.update_params(edited.play_begin(), [](int& p) { p += 10; });
+    assert(edited.front().second == 10);
+
+    // Kopia po update_params współdzieli dane.
+    playlist_t snapshot = edited;
+    assert(&std::as_const(snapshot).params(snapshot.play_begin()) ==
+           &std::as_const(edited).params(edited.play_begin()));
+
+    // Wyjątek w fn zostawia plejlistę bez zmian.
+    bool thrown = false;
+    try {
+        snapshot.update_params(snapshot.play_begin(), [](int& p) {
+            p = -1;
+            throw std::runtime_error("fn");
+        });
+    } catch (std::runtime_error const&) {
+        thrown = true;
+    }
+    assert(thrown);
+    assert(snapshot.front().second == 10);
+    assert(edited.front().second == 10);
+}
+
+// 15: memory_usage rozdziela pamięć na struktury i właścicieli
+void test_15_memory_usage() {
+    std::clog << "[15] memory_usage\n";
+    playlist_t empty;
+    assert(empty.memory_usage().total() == 0);
+    assert(empty.memory_usage().owners == 0);
+
+    playlist_t pl;
+    for (int i = 0; i < 100; ++i) {
+        pl.push_back("t" + std::to_string(i % 10), i);
+    }
+    auto usage = pl.memory_usage();
+    assert(usage.owners == 1);
+    assert(usage.shared == 0 && usage.exclusive == usage.total());
+    assert(usage.sequence_nodes >= 100 * sizeof(std::string));
+    assert(usage.occurrence_nodes >= 100 * sizeof(void*));
+    assert(usage.index_nodes >= 10 * sizeof(std::string));
+    assert(usage.other > 0);
+
+    // Węzły mają stały rozmiar, więc zużycie rośnie liniowo.
+    pl.push_back("t0", 100);
+    auto grown = pl.memory_usage();
+    assert(grown.sequence_nodes - usage.sequence_nodes ==
+           usage.sequence_nodes / 100);
+    assert(grown.index_nodes == usage.index_nodes);
+
+    // Kopia współdzieli wszystko aż do pierwszej modyfikacji.
+    playlist_t copy = pl;
+    auto shared = copy.memory_usage();
+    assert(shared.owners == 2);
+    assert(shared.exclusive == 0 && shared.shared == grown.total());
+    copy.pop_front();
+    assert(copy.memory_usage().owners == 1);
+    assert(pl.memory_usage().exclusive == grown.total());
+}
+
+// 16: append przenosi wpisy innej plejlisty na koniec
+void test_16_append() {
+    std::clog << "[16] append\n";
+    playlist_t day, hour;
+    day.push_back("b", 0);
+    day.push_back("d", 1);
+    hour.push_back("a", 2);
+    hour.push_back("b", 3);
+    hour.push_back("e", 4);
+    hour.push_back("a", 5);
+    auto first = hour.play_begin();
+    day.append(std::move(hour));
+    assert(hour.size() == 0);
+    check_against(day, {{"b", 0}, {"d", 1}, {"a", 2}, {"b", 3}, {"e", 4}, {"a", 5}});
+    // Węzły zostały przeniesione, a nie skopiowane.
+    assert(&day.play(first).second == &day.play(std::next(day.play_begin(), 2)).second);
+
+    // Przeniesione wpisy zachowują się jak każde inne.
+    day.remove("b");
+    day.pop_front();
+    check_against(day, {{"a", 2}, {"e", 4}, {"a", 5}});
+    hour.push_back("z", 6);
+    check_against(hour, {{"z", 6}});
+
+    // Pusta plejlista przejmuje dane, także współdzielone.
+    playlist_t empty, source = day;
+    empty.append(std::move(source));
+    check_against(empty, {{"a", 2}, {"e", 4}, {"a", 5}});
+    assert(source.size() == 0);
+
+    // Współdzielone źródło jest kopiowane, jego kopie się nie zmieniają.
+    playlist_t block = day, kept = day;
+    playlist_t target;
+    target.push_back("e", 7);
+    target.append(std::move(block));
+    check_against(target, {{"e", 7}, {"a", 2}, {"e", 4}, {"a", 5}});
+    check_against(kept, {{"a", 2}, {"e", 4}, {"a", 5}});
+
+    // Wersja kopiująca i dołączanie do samej siebie.
+    target.append(kept);
+    target.append(target);
+    model_t twice = {{"e", 7}, {"a", 2}, {"e", 4}, {"a", 5}, {"a", 2}, {"e", 4}, {"a", 5}};
+    model_t expected = twice;
+    expected.insert(expected.end(), twice.begin(), twice.end());
+    check_against(target, expected);
+    check_against(kept, {{"a", 2}, {"e", 4}, {"a", 5}});
+
+    // Ograniczona plejlista zachowuje limit.
+    playlist_t bounded(3);
+    bounded.push_back("x", 8);
+    playlist_t tail = kept;
+    bounded.append(std::move(tail));
+    check_against(bounded, {{"a", 2}, {"e", 4}, {"a", 5}});
+}
+
+// Sprawdza, że wystąpienia każdego utworu są przechowywane w kolejności
+// odtwarzania: spread_view zachowuje kolejność wystąpień w ramach utworu.
+static void check_occurrence_order(playlist_t const& pl, model_t const& model) {
+    std::map<std::string, std::vector<int>> expected, spread;
+    for (auto const& [track, params] : model) {
+        expected[track].push_back(params);
+    }
+    for (auto it : pl.spread_view(1)) {
+        spread[pl.play(it).first].push_back(pl.play(it).second);
+    }
+    assert(spread == expected);
+}
+
+// 17: wstawianie i usuwanie w dowolnym miejscu
+void test_17_insert_erase() {
+    std::clog << "[17] insert and erase by iterator\n";
+    playlist_t pl;
+    auto it = pl.insert(pl.play_end(), "b", 1);
+    assert(pl.play(it).first == "b");
+    pl.insert(pl.play_begin(), "a", 0);
+    it = pl.insert(pl.play_end(), "a", 3);
+    pl.insert(it, "c", 2);
+    check_against(pl, {{"a", 0}, {"b", 1}, {"c", 2}, {"a", 3}});
+
+    it = pl.erase(std::next(pl.play_begin()));
+    assert(pl.play(it).first == "c");
+    it = pl.erase(std::next(it));
+    assert(it == pl.play_end());
+    check_against(pl, {{"a", 0}, {"c", 2}});
+
+    bool thrown = false;
+    try {
+        pl.erase(pl.play_end());
+    } catch (std::out_of_range const&) {
+        thrown = true;
+    }
+    assert(thrown);
+
+    // Współdzielone dane: iterator wskazuje odpowiednik w kopii.
+    playlist_t copy = pl;
+    it = pl.insert(std::next(pl.play_begin()), "x", 1);
+    assert(pl.play(it).first == "x");
+    it = pl.erase(pl.play_begin());
+    assert(pl.play(it).first == "x");
+    check_against(pl, {{"x", 1}, {"c", 2}});
+    check_against(copy, {{"a", 0}, {"c", 2}});
+    playlist_t other = copy;
+    it = copy.erase(std::next(copy.play_begin()));
+    assert(it == copy.play_end());
+    check_against(copy, {{"a", 0}});
+    check_against(other, {{"a", 0}, {"c", 2}});
+
+    // Ograniczona plejlista usuwa najstarszy wpis.
+    playlist_t bounded(2);
+    bounded.push_back("a", 0);
+    bounded.push_back("b", 1);
+    it = bounded.insert(std::next(bounded.play_begin()), "c", 2);
+    assert(bounded.play(it).first == "c");
+    check_against(bounded, {{"c", 2}, {"b", 1}});
+    it = bounded.insert(bounded.play_begin(), "d", 3);
+    assert(it == bounded.play_begin());
+    check_against(bounded, {{"c", 2}, {"b", 1}});
+
+    // Wielokrotne wstawianie w to samo miejsce wyczerpuje etykiety.
+    playlist_t dense;
+    dense.push_back("a", 0);
+    dense.push_back("a", 1000);
+    model_t dense_model = {{"a", 0}, {"a", 1000}};
+    auto before = std::next(dense.play_begin());
+    for (int i = 999; i > 900; --i) {
+        before = dense.insert(before, i % 2 ? "a" : "b", i);
+        dense_model.insert(dense_model.begin() + (1000 - i), {i % 2 ? "a" : "b", i});
+        dense.insert(dense.play_begin(), i % 2 ? "c" : "d", -i);
+        dense_model.push_front({i % 2 ? "c" : "d", -i});
+    }
+    check_against(dense, dense_model);
+    check_occurrence_order(dense, dense_model);
+}
+
+// 18: losowe wstawianie i usuwanie zgodne z modelem
+void test_18_insert_erase_random() {
+    std::clog << "[18] random insert and erase\n";
+    unsigned state = 777;
+    auto next = [&state](unsigned bound) {
+        state = state * 1103515245u + 12345u;
+        return (state >> 16) % bound;
+    };
+    playlist_t pl;
+    model_t model;
+    for (int step = 0; step < 2000; ++step) {
+        unsigned op = next(10);
+        if (op < 6 || model.empty()) {
+            unsigned at = next(static_cast<unsigned>(model.size()) + 1);
+            std::string track = "t" + std::to_string(next(5));
+            auto it = pl.insert(std::next(pl.play_begin(), at), track, step);
+            assert(pl.play(it).second == step);
+            model.insert(model.begin() + at, {track, step});
+        } else if (op < 9) {
+            unsigned at = next(static_cast<unsigned>(model.size()));
+            pl.erase(std::next(pl.play_begin(), at));
+            model.erase(model.begin() + at);
+        } else {
+            pl.pop_front();
+            model.pop_front();
+        }
+        if (step % 100 == 0) {
+            playlist_t snapshot = pl;
+            check_against(snapshot, model);
+        }
+    }
+    check_against(pl, model);
+    check_occurrence_order(pl, model);
+
+    // Dalsze operacje zakładające kolejność wystąpień.
+    playlist_t appended;
+    appended.push_back("t0", -1);
+    appended.append(std::move(pl));
+    model.push_front({"t0", -1});
+    check_occurrence_order(appended, model);
+}
+
+// Porównuje sorted_index i count z licznościami z modelu.
+static void check_sorted_index(playlist_t const& pl, model_t const& model) {
+    std::map<std::string, std::size_t> counts;
+    for (auto const& item : model) {
+        ++counts[item.first];
+    }
+    auto range = pl.sorted_index();
+    assert(range.size() == counts.size());
+    auto expected = counts.begin();
+    for (auto [track, count] : range) {
+        assert(track == expected->first && count == expected->second);
+        assert(pl.count(track) == count);
+        ++expected;
+    }
+    assert(pl.count("missing") == 0);
+
+    auto visited = counts.begin();
+    pl.for_each_sorted([&](std::string const& track, std::size_t count) {
+        assert(visited != counts.end());
+        assert(track == visited->first && count == visited->second);
+        ++visited;
+    });
+    assert(visited == counts.end());
+}
+
+// 19: płaski indeks nadąża za zmianami plejlisty
+void test_19_sorted_index() {
+    std::clog << "[19] sorted index\n";
+    playlist_t empty;
+    assert(empty.sorted_index().size() == 0);
+    assert(empty.count("a") == 0);
+
+    unsigned state = 4242;
+    auto next = [&state](unsigned bound) {
+        state = state * 1103515245u + 12345u;
+        return (state >> 16) % bound;
+    };
+    playlist_t pl;
+    model_t model;
+    for (int step = 0; step < 3000; ++step) {
+        unsigned op = next(20);
+        std::string track = "t" + std::to_string(next(60));
+        if (op < 10 || model.empty()) {
+            pl.push_back(track, step);
+            model.push_back({track, step});
+        } else if (op < 13) {
+            unsigned at = next(static_cast<unsigned>(model.size()) + 1);
+            pl.insert(std::next(pl.play_begin(), at), track, step);
+            model.insert(model.begin() + at, {track, step});
+        } else if (op < 16) {
+            pl.pop_front();
+            model.pop_front();
+        } else if (op < 18) {
+            unsigned at = next(static_cast<unsigned>(model.size()));
+            pl.erase(std::next(pl.play_begin(), at));
+            model.erase(model.begin() + at);
+        } else if (op == 18) {
+            track = model[next(static_cast<unsigned>(model.size()))].first;
+            pl.remove(track);
+            std::erase_if(model, [&](auto const& item) { return item.first == track; });
+        } else {
+            playlist_t copy = pl;
+            copy.push_back(track, step);
+            model_t copy_model = model;
+            copy_model.push_back({track, step});
+            check_sorted_index(copy, copy_model);
+        }
+        if (next(4) == 0) {
+            check_sorted_index(pl, model);
+        }
+    }
+    check_sorted_index(pl, model);
+
+    // Ograniczona plejlista i łączenie plejlist.
+    playlist_t bounded(5);
+    model_t bounded_model;
+    for (int i = 0; i < 40; ++i) {
+        std::string track = "b" + std::to_string(i % 7);
+        bounded.push_back(track, i);
+        bounded_model.push_back({track, i});
+        if (bounded_model.size() > 5) {
+            bounded_model.pop_front();
+        }
+        check_sorted_index(bounded, bounded_model);
+    }
+    pl.append(std::move(bounded));
+    model.insert(model.end(), bounded_model.begin(), bounded_model.end());
+    check_sorted_index(pl, model);
+    pl.clear();
+    check_sorted_index(pl, {});
+}
+
+// Porównuje plejlistę z dowolnym typem utworów z modelem.
+template <typename Track>
+static void check_generic(cxx::playlist<Track, int> const& pl,
+                          std::deque<std::pair<Track, int>> const& model) {
+    assert(pl.size() == model.size());
+    auto it = pl.play_begin();
+    std::map<Track, std::size_t> counts;
+    for (auto const& [track, params] : model) {
+        assert(pl.play(it).first == track && pl.play(it).second == params);
+        ++counts[track];
+        ++it;
+    }
+    auto expected = counts.begin();
+    for (auto sorted = pl.sorted_begin(); sorted != pl.sorted_end(); ++sorted) {
+        assert(pl.pay(sorted).first == expected->first);
+        assert(pl.pay(sorted).second == expected->second);
+        assert(pl.count(expected->first) == expected->second);
+        ++expected;
+    }
+    assert(expected == counts.end());
+}
+
+// Losowe operacje na plejliście z utworami z podanego zbioru.
+template <typename Track, typename Make>
+static void random_direct_index(Make make, unsigned values) {
+    using list_t = cxx::playlist<Track, int>;
+    std::deque<std::pair<Track, int>> model;
+    list_t pl(0);
+    unsigned state = 99;
+    auto next = [&state](unsigned bound) {
+        state = state * 1103515245u + 12345u;
+        return (state >> 16) % bound;
+    };
+    for (int step = 0; step < 3000; ++step) {
+        unsigned op = next(10);
+        Track track = make(next(values));
+        if (op < 5 || model.empty()) {
+            pl.push_back(track, step);
+            model.push_back({track, step});
+        } else if (op < 7) {
+            pl.pop_front();
+            model.pop_front();
+        } else if (op == 7) {
+            track = model[next(static_cast<unsigned>(model.size()))].first;
+            pl.remove(track);
+            std::erase_if(model, [&](auto const& item) { return item.first == track; });
+        } else if (op == 8) {
+            list_t copy = pl;
+            copy.push_back(track, step);
+            auto copy_model = model;
+            copy_model.push_back({track, step});
+            pl.pop_front();
+            model.pop_front();
+            check_generic(copy, copy_model);
+        } else {
+            list_t other;
+            other.push_back(track, step);
+            pl.append(std::move(other));
+            model.push_back({track, step});
+        }
+        if (step % 50 == 0) {
+            check_generic(pl, model);
+        }
+    }
+    check_generic(pl, model);
+    pl.clear();
+    pl.push_back(make(0), 0);
+    check_generic(pl, {{make(0), 0}});
+}
+
+enum class Genre : unsigned char { pop, rock, jazz, folk, metal };
+
+// 20: utwory o małym zakresie wartości trafiają do tablicy
+void test_20_direct_index() {
+    std::clog << "[20] direct index for small track types\n";
+    random_direct_index<char>(
+        [](unsigned v) { return static_cast<char>(static_cast<int>(v) - 128); }, 256);
+    random_direct_index<unsigned char>(
+        [](unsigned v) { return static_cast<unsigned char>(v); }, 256);
+    random_direct_index<Genre>([](unsigned v) { return static_cast<Genre>(v); }, 5);
+    // Wartości spoza zadeklarowanego zakresu korzystają tylko z drzewa.
+    random_direct_index<short>(
+        [](unsigned v) { return static_cast<short>(static_cast<int>(v) * 3 - 30); }, 60);
+
+    // Ograniczona plejlista przemianowuje węzły indeksu.
+    cxx::playlist<char, int> bounded(3);
+    std::deque<std::pair<char, int>> model;
+    for (int i = 0; i < 50; ++i) {
+        char track = static_cast<char>('a' + (i * 7) % 5);
+        bounded.push_back(track, i);
+        model.push_back({track, i});
+        if (model.size() > 3) {
+            model.pop_front();
+        }
+        check_generic(bounded, model);
+    }
+}
+
+// 21: widoki zakresów i paczki parametrów
+void test_21_ranges() {
+    std::clog << "[21] range views and batches\n";
+    static_assert(std::bidirectional_iterator<playlist_t::play_iterator>);
+    static_assert(std::bidirectional_iterator<playlist_t::sorted_iterator>);
+    static_assert(std::ranges::bidirectional_range<
+                  decltype(std::declval<playlist_t const&>().play_view())>);
+    static_assert(std::ranges::bidirectional_range<
+                  decltype(std::declval<playlist_t const&>().sorted_view())>);
+    static_assert(std::ranges::input_range<playlist_t::batch_range>);
+
+    playlist_t empty;
+    assert(std::ranges::empty(empty.play_view()));
+    assert(std::ranges::empty(empty.sorted_view()));
+    assert(std::ranges::distance(empty.batches(4)) == 0);
+
+    playlist_t pl;
+    model_t model;
+    for (int i = 0; i < 11; ++i) {
+        std::string track = "t" + std::to_string(i % 3);
+        pl.push_back(track, i);
+        model.push_back({track, i});
+    }
+
+    auto it = model.rbegin();
+    for (auto [track, params] : pl.play_view() | std::views::reverse) {
+        assert(track == it->first && params == it->second);
+        ++it;
+    }
+    auto first = pl.play_begin();
+    assert(&(*first).first == &pl.play(first).first);
+    assert(&(*first).second == &pl.params(first));
+    auto found = std::ranges::find_if(pl.play_view(),
+        [](auto const& e) { return e.second == 7; });
+    assert(found != pl.play_end() && (*found).first == "t1");
+
+    std::vector<std::string> sorted(pl.sorted_view().begin(),
+                                    pl.sorted_view().end());
+    assert((sorted == std::vector<std::string>{"t0", "t1", "t2"}));
+
+    std::vector<std::size_t> sizes;
+    int expected = 0;
+    for (auto span : pl.batches(4)) {
+        sizes.push_back(span.size());
+        for (int params : span) {
+            assert(params == expected++);
+        }
+    }
+    assert((sizes == std::vector<std::size_t>{4, 4, 3}));
+    int sum = 0;
+    for (auto span : pl.batches(100)) {
+        sum += std::accumulate(span.begin(), span.end(), 0);
+    }
+    assert(sum == 55);
+
+    bool thrown = false;
+    try {
+        (void)pl.batches(0);
+    } catch (std::invalid_argument const&) {
+        thrown = true;
+    }
+    assert(thrown);
+}
+
+// 22: przejście po indeksie z pobieraniem z wyprzedzeniem
+void test_22_for_each_sorted() {
+    std::clog << "[22] for_each_sorted\n";
+    playlist_t empty;
+    empty.for_each_sorted([](std::string const&, std::size_t) { assert(false); });
+
+    // Więcej utworów niż odległość pobierania z wyprzedzeniem.
+    playlist_t pl;
+    model_t model;
+    for (int i = 0; i < 500; ++i) {
+        std::string track = "t" + std::to_string(i * 37 % 101);
+        pl.push_back(track, i);
+        model.push_back({track, i});
+    }
+    check_sorted_index(pl, model);
+
+    std::size_t total = 0;
+    auto sorted = pl.sorted_begin();
+    pl.for_each_sorted([&](std::string const& track, std::size_t count) {
+        assert(&track == &*sorted);
+        ++sorted;
+        total += count;
+    });
+    assert(sorted == pl.sorted_end() && total == 500);
+
+    pl.remove("t0");
+    pl.push_back("zz", 0);
+    model.push_back({"zz", 0});
+    std::erase_if(model, [](auto const& item) { return item.first == "t0"; });
+    check_sorted_index(pl, model);
+}
+
+// 23: kopie współdzielące dane czytane z dwóch wątków budują warstwy raz
+void test_23_shared_readers() {
+    std::clog << "[23] readers of shared data on two threads\n";
+    playlist_t base;
+    for (int i = 0; i < 2000; ++i) {
+        base.push_back("t" + std::to_string(i % 97), i);
+    }
+    for (int round = 0; round < 20; ++round) {
+        // Zmiana unieważnia warstwy, obie kopie zaczynają od zera; co drugi
+        // raz indeks płaski zostaje i tylko dołącza nowy utwór.
+        if (round % 2 == 0 && round >= 2) {
+            base.remove("r" + std::to_string(round - 2));
+        }
+        base.push_back("r" + std::to_string(round), round);
+        playlist_t a = base, b = base;
+
+        auto read = [](playlist_t const& pl, long long& sum) {
+            for (auto const& [track, params] : pl.shuffle_view(7)) {
+                sum += params;
+            }
+            for (auto [track, count] : pl.sorted_index()) {
+                sum += static_cast<long long>(count * pl.count(track));
+            }
+            pl.for_each_sorted([&](std::string const&, std::size_t count) {
+                sum -= static_cast<long long>(count);
+            });
+            for (auto it = pl.play_begin(); it != pl.play_end(); ++it) {
+                sum += pl.play(pl.find(pl.id(it))).second;
+            }
+        };
+        long long sum_a = 0, sum_b = 0;
+        std::thread reader([&] { read(a, sum_a); });
+        read(b, sum_b);
+        reader.join();
+        assert(sum_a == sum_b);
+    }
+}
+
+// ======================== main ========================
+
+int main() {
+    try {
+        test_01_bounded_drops_oldest();
+        test_02_bounded_track_churn();
+        test_03_bounded_copy_on_write();
+        test_04_bounded_append_range();
+        test_05_shuffle_visits_each_once();
+        test_06_shuffle_is_deterministic();
+        test_07_shuffle_after_modification();
+        test_08_respace();
+        test_09_respace_impossible();
+        test_10_respace_random();
+        test_11_small_playlists();
+        test_12_cross_thread_destruction();
+        test_13_shared_first_write();
+        test_14_update_params();
+        test_15_memory_usage();
+        test_16_append();
+        test_17_insert_erase();
+        test_18_insert_erase_random();
+        test_19_sorted_index();
+        test_20_direct_index();
+        test_21_ranges();
+        test_22_for_each_sorted();
+        test_23_shared_readers();
+    } catch (...) {
+        assert(false && "Uncaught exception in tests");
+    }
+
+    std::clog << "ALL EXTENSION TESTS PASSED\n";
+    return 0;
+}
@@ -0,0 +1,156 @@
+#define CXX_PLAYLIST_STATS
+#include "playlist.h"
+
+#ifdef NDEBUG
+#  undef NDEBUG
+#endif
+
+#include <cassert>
+#include <cstddef>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+// ======================== Narzędzia testowe ========================
+
+using playlist_t = cxx::playlist<std::string, int>;
+
+// Typ parametrów, którego kopiowanie zawodzi po zadanej liczbie kopii.
+struct FragileParams {
+    int value{};
+    static int copies_left;
+
+    FragileParams(int v) : value(v) {}
+    FragileParams(FragileParams const& other) : value(other.value) {
+        if (copies_left == 0) {
+            throw std::runtime_error("copy");
+        }
+        if (copies_left > 0) {
+            --copies_left;
+        }
+    }
+    FragileParams& operator=(FragileParams const&) = default;
+};
+
+int FragileParams::copies_left = -1;
+
+// ======================== Testy ========================
+
+// 01: liczniki kopiowania współdzielonych danych
+void test_01_deep_copies() {
+    std::clog << "[01] deep copy counters\n";
+    playlist_t pl;
+    for (int i = 0; i < 10; ++i) {
+        pl.push_back("t" + std::to_string(i % 3), i);
+    }
+    cxx::playlist_stats::reset();
+
+    playlist_t copy = pl;
+    auto stats = cxx::playlist_stats::global();
+    assert(stats.deep_copies == 0);
+
+    copy.pop_front();
+    stats = cxx::playlist_stats::global();
+    assert(stats.deep_copies == 1);
+    assert(stats.entries_copied == 9);
+
+    copy.pop_front();
+    assert(cxx::playlist_stats::global().deep_copies == 1);
+}
+
+// 02: wyszukiwania w indeksie i alokacje węzłów
+void test_02_lookups_and_allocations() {
+    std::clog << "[02] lookups and allocations\n";
+    cxx::playlist_stats::reset();
+    playlist_t pl;
+    assert(cxx::playlist_stats::global().node_allocations == 0);
+    pl.push_back("a", 1);
+    auto stats = cxx::playlist_stats::global();
+    assert(stats.index_lookups == 1);
+    // Dane, węzeł indeksu, węzeł wystąpienia i węzeł sekwencji.
+    assert(stats.node_allocations == 4);
+
+    pl.push_back("a", 2);
+    stats = cxx::playlist_stats::global();
+    assert(stats.index_lookups == 2);
+    assert(stats.node_allocations == 6);
+
+    pl.remove("a");
+    assert(cxx::playlist_stats::global().index_lookups == 3);
+}
+
+// 03: wycofanie nieudanych modyfikacji
+void test_03_rollbacks() {
+    std::clog << "[03] rollback counter\n";
+    cxx::playlist<int, FragileParams> pl;
+    pl.push_back(1, FragileParams(1));
+    auto copy = pl;
+    cxx::playlist_stats::reset();
+
+    // Kopia danych się udaje, zawodzi dopiero dodawany element.
+    FragileParams p(2);
+    FragileParams::copies_left = 1;
+    bool thrown = false;
+    try {
+        copy.push_back(2, p);
+    } catch (std::runtime_error const&) {
+        thrown = true;
+    }
+    FragileParams::copies_left = -1;
+    assert(thrown);
+    assert(copy.size() == 1);
+    auto stats = cxx::playlist_stats::global();
+    assert(stats.deep_copies == 1);
+    assert(stats.rollbacks == 1);
+
+    // Niewspółdzielone dane: append_range wycofuje dodane elementy.
+    pl.push_back(2, p);
+    copy.clear();
+    std::vector<std::pair<int, FragileParams>> batch = {{3, 3}, {4, 4}};
+    FragileParams::copies_left = 1;
+    thrown = false;
+    try {
+        pl.append_range(batch);
+    } catch (std::runtime_error const&) {
+        thrown = true;
+    }
+    FragileParams::copies_left = -1;
+    assert(thrown);
+    assert(pl.size() == 2);
+    assert(cxx::playlist_stats::global().rollbacks == 2);
+}
+
+// 04: append niewspółdzielonych plejlist niczego nie kopiuje ani nie alokuje
+void test_04_append_without_copies() {
+    std::clog << "[04] append without copies\n";
+    playlist_t day, hour;
+    for (int i = 0; i < 100; ++i) {
+        day.push_back("t" + std::to_string(i % 7), i);
+        hour.push_back("t" + std::to_string(i % 11), i);
+    }
+    cxx::playlist_stats::reset();
+    day.append(std::move(hour));
+    auto stats = cxx::playlist_stats::global();
+    assert(day.size() == 200);
+    assert(stats.deep_copies == 0);
+    assert(stats.entries_copied == 0);
+    assert(stats.node_allocations == 0);
+}
+
+// ======================== main ========================
+
+int main() {
+    try {
+        test_01_deep_copies();
+        test_02_lookups_and_allocations();
+        test_03_rollbacks();
+        test_04_append_without_copies();
+    } catch (...) {
+        assert(false && "Uncaught exception in tests");
+    }
+
+    std::clog << "ALL STATS TESTS PASSED\n";
+    return 0;
+}
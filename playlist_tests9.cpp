@@ -0,0 +1,188 @@
+#include "sharded_playlist.h"
+
+#ifdef NDEBUG
+#  undef NDEBUG
+#endif
+
+#include <cassert>
+#include <cstddef>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// ======================== Narzędzia testowe ========================
+
+// {numer wątku, numer zdarzenia w wątku}
+using params_t = std::pair<unsigned, unsigned>;
+using sharded_t = cxx::sharded_playlist<std::string, params_t>;
+using playlist_t = cxx::playlist<std::string, params_t>;
+
+static std::vector<params_t> played(playlist_t const& pl) {
+    std::vector<params_t> out;
+    for (auto it = pl.play_begin(); it != pl.play_end(); ++it) {
+        out.push_back(pl.play(it).second);
+    }
+    return out;
+}
+
+// Utwór, którego porównanie rzuca wyjątek, gdy fail jest ustawione.
+struct fragile {
+    static inline bool fail = false;
+    int id;
+
+    bool operator<(fragile const& other) const {
+        if (fail) {
+            throw std::runtime_error("compare");
+        }
+        return id < other.id;
+    }
+    bool operator==(fragile const& other) const = default;
+};
+
+// ======================== Testy ========================
+
+// 01: jeden wątek – kolejność dodawania jest zachowana
+void test_01_single_writer() {
+    std::clog << "[01] single writer\n";
+    sharded_t s(4, 3);
+    for (unsigned i = 0; i < 10; ++i) {
+        s.push_back("t" + std::to_string(i % 4), {0, i});
+    }
+    auto pl = s.snapshot();
+    assert(pl.size() == 10);
+    auto items = played(pl);
+    for (unsigned i = 0; i < 10; ++i) {
+        assert(items[i].second == i);
+    }
+    assert(pl.front().first == "t0");
+    assert(pl.pay(pl.sorted_begin()).second == 3);
+}
+
+// 02: migawka nie widzi późniejszych zdarzeń
+void test_02_snapshot_isolation() {
+    std::clog << "[02] snapshot isolation\n";
+    sharded_t s(2, 1);
+    s.push_back("a", {0, 0});
+    auto before = s.snapshot();
+    s.push_back("b", {0, 1});
+    s.flush();
+    assert(before.size() == 1);
+    assert(s.snapshot().size() == 2);
+    assert(before.size() == 1);
+}
+
+// 03: wielu piszących – nic nie ginie, kolejność w wątku zachowana
+void test_03_concurrent_writers() {
+    std::clog << "[03] concurrent writers\n";
+    constexpr unsigned threads = 8;
+    constexpr unsigned per_thread = 2000;
+    sharded_t s(3, 64);
+    std::vector<std::thread> writers;
+    for (unsigned t = 0; t < threads; ++t) {
+        writers.emplace_back([&s, t] {
+            for (unsigned i = 0; i < per_thread; ++i) {
+                s.push_back("t" + std::to_string((t + i) % 5), {t, i});
+            }
+        });
+    }
+    for (auto& w : writers) {
+        w.join();
+    }
+
+    auto pl = s.snapshot();
+    assert(pl.size() == threads * per_thread);
+    std::vector<unsigned> next(threads, 0);
+    for (auto const& [t, i] : played(pl)) {
+        assert(i == next[t]);
+        ++next[t];
+    }
+    size_t total = 0;
+    for (auto it = pl.sorted_begin(); it != pl.sorted_end(); ++it) {
+        total += pl.pay(it).second;
+    }
+    assert(total == threads * per_thread);
+}
+
+// 04: migawki w trakcie zapisu są prefiksami wyniku końcowego
+void test_04_snapshots_are_prefixes() {
+    std::clog << "[04] snapshots during writes are prefixes\n";
+    constexpr unsigned threads = 4;
+    constexpr unsigned per_thread = 1000;
+    sharded_t s(2, 16);
+    std::vector<playlist_t> snapshots;
+    std::vector<std::thread> writers;
+    for (unsigned t = 0; t < threads; ++t) {
+        writers.emplace_back([&s, t] {
+            for (unsigned i = 0; i < per_thread; ++i) {
+                s.push_back("x", {t, i});
+            }
+        });
+    }
+    for (unsigned k = 0; k < 20; ++k) {
+        snapshots.push_back(s.snapshot());
+    }
+    for (auto& w : writers) {
+        w.join();
+    }
+
+    auto all = played(s.snapshot());
+    assert(all.size() == threads * per_thread);
+    for (auto const& snap : snapshots) {
+        auto part = played(snap);
+        assert(part.size() <= all.size());
+        for (size_t i = 0; i < part.size(); ++i) {
+            assert(part[i] == all[i]);
+        }
+    }
+}
+
+// 05: nieudane scalanie w push_back nie gubi ani nie dubluje zdarzenia
+void test_05_failed_merge() {
+    std::clog << "[05] failed merge inside push_back\n";
+    cxx::sharded_playlist<fragile, unsigned> s(1, 1);
+    s.push_back({1}, 0);
+    fragile::fail = true;
+    s.push_back({2}, 1);
+    s.push_back({3}, 2);
+    fragile::fail = false;
+
+    auto pl = s.snapshot();
+    assert(pl.size() == 3);
+    unsigned expected = 0;
+    for (auto it = pl.play_begin(); it != pl.play_end(); ++it) {
+        assert(pl.play(it).first.id == static_cast<int>(expected) + 1);
+        assert(pl.play(it).second == expected++);
+    }
+
+    // flush() i snapshot() zgłaszają błąd scalania.
+    fragile::fail = true;
+    s.push_back({4}, 3);
+    bool thrown = false;
+    try {
+        s.flush();
+    } catch (std::runtime_error const&) {
+        thrown = true;
+    }
+    fragile::fail = false;
+    assert(thrown && s.snapshot().size() == 4);
+}
+
+// ======================== main ========================
+
+int main() {
+    try {
+        test_01_single_writer();
+        test_02_snapshot_isolation();
+        test_03_concurrent_writers();
+        test_04_snapshots_are_prefixes();
+        test_05_failed_merge();
+    } catch (...) {
+        assert(false && "Uncaught exception in tests");
+    }
+
+    std::clog << "ALL SHARDED TESTS PASSED\n";
+    return 0;
+}
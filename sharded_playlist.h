@@ -0,0 +1,179 @@
+#ifndef SHARDED_PLAYLIST_H
+#define SHARDED_PLAYLIST_H
+
+#include "playlist.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ranges>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace cxx
+{
+
+    // Playlist accepting push_back from many threads at once.
+    //
+    // Writers append to one of several shard buffers (chosen per thread),
+    // so they only contend with the few threads sharing their shard. Every
+    // event gets a global sequence number when it is buffered; buffers are
+    // merged into the underlying playlist in batches, in sequence order, by
+    // whichever writer fills its buffer first or by flush(). Events whose
+    // predecessors are still being buffered by another thread wait for the
+    // next merge, so the merged playlist is always a prefix of the global
+    // order.
+    //
+    // Reads go through snapshot(), a copy of the merged playlist sharing
+    // its data. A merge performed while snapshots are alive copies the data
+    // first (copy on write), so snapshots can be read from any thread.
+    template <typename T, typename P>
+    class sharded_playlist
+    {
+    private:
+        struct Event
+        {
+            std::uint64_t seq;
+            T track;
+            P params;
+        };
+
+        // Shards live on separate cache lines.
+        struct alignas(64) Shard
+        {
+            std::mutex mutex;
+            std::vector<Event> buffer;
+        };
+
+        std::unique_ptr<Shard[]> shards_;
+        size_t shard_count_;
+        size_t batch_size_;
+        std::atomic<std::uint64_t> next_seq_{0};
+
+        // Guarded by merge_mutex_.
+        std::mutex merge_mutex_;
+        playlist<T, P> merged_;
+        std::vector<Event> pending_;
+        std::uint64_t next_merged_ = 0;
+
+        Shard &local_shard() noexcept
+        {
+            static std::atomic<size_t> tickets{0};
+            thread_local size_t ticket = tickets.fetch_add(1);
+            return shards_[ticket % shard_count_];
+        }
+
+        // Moves the buffered events into the playlist, up to the first
+        // sequence number that is not buffered yet. Either the whole batch
+        // is merged or, on exception, the playlist is left unchanged and the
+        // events stay pending.
+        void merge_locked()
+        {
+            size_t collected = pending_.size();
+            for (size_t i = 0; i < shard_count_; ++i)
+            {
+                std::lock_guard<std::mutex> lock(shards_[i].mutex);
+                pending_.reserve(pending_.size() + shards_[i].buffer.size());
+                std::move(shards_[i].buffer.begin(), shards_[i].buffer.end(),
+                    std::back_inserter(pending_));
+                shards_[i].buffer.clear();
+            }
+
+            auto by_seq = [](Event const &a, Event const &b)
+            {
+                return a.seq < b.seq;
+            };
+            std::sort(pending_.begin() + static_cast<std::ptrdiff_t>(collected),
+                pending_.end(), by_seq);
+            std::inplace_merge(pending_.begin(),
+                pending_.begin() + static_cast<std::ptrdiff_t>(collected),
+                pending_.end(), by_seq);
+
+            size_t ready = 0;
+            while (ready < pending_.size() &&
+                pending_[ready].seq == next_merged_ + ready)
+            {
+                ++ready;
+            }
+            if (ready == 0)
+                return;
+
+            merged_.append_range(pending_ | std::views::take(ready) |
+                std::views::transform([](Event const &e)
+                {
+                    return std::pair<T const &, P const &>(e.track, e.params);
+                }));
+            pending_.erase(pending_.begin(),
+                pending_.begin() + static_cast<std::ptrdiff_t>(ready));
+            next_merged_ += ready;
+        }
+
+    public:
+        // Creates an empty playlist with the given number of shards; a
+        // writer merges once its shard holds batch_size events.
+        explicit sharded_playlist(
+            size_t shards = std::thread::hardware_concurrency(),
+            size_t batch_size = 256)
+            : shards_(std::make_unique<Shard[]>(shards == 0 ? 1 : shards)),
+              shard_count_(shards == 0 ? 1 : shards),
+              batch_size_(batch_size == 0 ? 1 : batch_size) {}
+
+        sharded_playlist(sharded_playlist const &) = delete;
+        sharded_playlist &operator=(sharded_playlist const &) = delete;
+
+        // Buffers {track, params}; safe to call from any number of threads.
+        // On exception the event is not added. Once buffered it stays added:
+        // if the merge it triggers throws, the events stay pending and the
+        // next merge retries them, so a caller never sees a failure for an
+        // event that will still be merged.
+        // O(const) amortized, plus a merge for every batch_size events.
+        void push_back(T const &track, P const &params)
+        {
+            Shard &shard = local_shard();
+            bool full;
+            {
+                std::lock_guard<std::mutex> lock(shard.mutex);
+                shard.buffer.push_back(Event{0, track, params});
+                // Numbered only once buffered, so a merge never waits for a
+                // number whose event failed to be added.
+                shard.buffer.back().seq = next_seq_.fetch_add(1);
+                full = shard.buffer.size() >= batch_size_;
+            }
+
+            if (full && merge_mutex_.try_lock())
+            {
+                std::lock_guard<std::mutex> lock(merge_mutex_, std::adopt_lock);
+                try
+                {
+                    merge_locked();
+                }
+                catch (...)
+                {
+                }
+            }
+        }
+
+        // Merges all buffered events whose predecessors are buffered too;
+        // when no writer is running, that is all of them.
+        void flush()
+        {
+            std::lock_guard<std::mutex> lock(merge_mutex_);
+            merge_locked();
+        }
+
+        // Gets the merged playlist after a flush(). The copy shares the data,
+        // so it costs O(const).
+        playlist<T, P> snapshot()
+        {
+            std::lock_guard<std::mutex> lock(merge_mutex_);
+            merge_locked();
+            return merged_;
+        }
+    };
+
+} // namespace cxx
+
+#endif // SHARDED_PLAYLIST_H
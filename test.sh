@@ -103,7 +103,7 @@ fi
 # ---------------------------------------------------------
 
 # Lista plików testowych
-TEST_FILES=("playlist_tests1.cpp" "playlist_tests2.cpp" "playlist_tests3.cpp" "playlist_tests4.cpp" "playlist_tests5.cpp")
+TEST_FILES=("playlist_tests1.cpp" "playlist_tests2.cpp" "playlist_tests3.cpp" "playlist_tests4.cpp" "playlist_tests5.cpp" "playlist_tests6.cpp" "playlist_tests7.cpp" "playlist_tests8.cpp" "playlist_tests9.cpp" "playlist_tests10.cpp" "playlist_tests11.cpp" "playlist_tests12.cpp" "playlist_tests13.cpp" "playlist_tests14.cpp" "playlist_tests15.cpp" "playlist_tests16.cpp")
 
 for FILE in "${TEST_FILES[@]}"; do
     # Wyciągnij nazwę bez rozszerzenia (np. playlist_tests1)
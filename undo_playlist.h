@@ -0,0 +1,288 @@
+#ifndef UNDO_PLAYLIST_H
+#define UNDO_PLAYLIST_H
+
+#include "playlist.h"
+
+#include <cstddef>
+#include <deque>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace cxx
+{
+
+    // Playlist with undo and redo of its modifications.
+    //
+    // Every modification records its inverse instead of a copy of the
+    // playlist: the pushed or popped entry, the removed entries with their
+    // positions in play order, or, for clear(), the old data itself, which
+    // the cleared playlist no longer shares. Undo and redo so cost about
+    // as much as the modification, and never copy the whole playlist.
+    //
+    // The history is bounded by the number of entries it holds: once it
+    // exceeds history_limit, the oldest modifications are forgotten (an
+    // edit larger than the limit cannot be undone at all). A modification
+    // discards everything that could be redone.
+    template <typename T, typename P>
+    class undo_playlist
+    {
+    private:
+        struct PushBack
+        {
+            T track;
+            P params;
+        };
+
+        struct PopFront
+        {
+            T track;
+            P params;
+        };
+
+        // Positions are in the playlist before the removal, increasing.
+        struct Remove
+        {
+            T track;
+            std::vector<std::pair<size_t, P>> removed;
+        };
+
+        // The size is kept apart, as before is moved out while the record
+        // waits for redo().
+        struct Clear
+        {
+            playlist<T, P> before;
+            size_t entries;
+        };
+
+        using Record = std::variant<PushBack, PopFront, Remove, Clear>;
+
+        playlist<T, P> list_;
+        std::deque<Record> undo_;
+        std::deque<Record> redo_;
+        size_t history_limit_;
+        size_t history_entries_ = 0;
+
+        static size_t entries(Record const &record) noexcept
+        {
+            if (auto const *remove = std::get_if<Remove>(&record))
+                return remove->removed.size();
+            if (auto const *clear = std::get_if<Clear>(&record))
+                return clear->entries;
+            return 1;
+        }
+
+        // Records the modification, then applies it; if it throws, the
+        // record is dropped again.
+        template <typename Mutation>
+        void record(Record &&rec, Mutation &&mutation)
+        {
+            undo_.push_back(std::move(rec));
+            try
+            {
+                mutation();
+            }
+            catch (...)
+            {
+                undo_.pop_back();
+                throw;
+            }
+            history_entries_ += entries(undo_.back());
+            for (Record const &dropped : redo_)
+                history_entries_ -= entries(dropped);
+            redo_.clear();
+            trim();
+        }
+
+        void trim() noexcept
+        {
+            while (history_entries_ > history_limit_ && !undo_.empty())
+            {
+                history_entries_ -= entries(undo_.front());
+                undo_.pop_front();
+            }
+        }
+
+        // Finds the positions of the entries of the track, in play order.
+        // O(n)
+        std::vector<std::pair<size_t, P>> occurrences(T const &track) const
+        {
+            std::vector<std::pair<size_t, P>> found;
+            T const *key = nullptr;
+            size_t position = 0;
+            for (auto [t, params] : list_.play_view())
+            {
+                if (key ? &t == key : !(t < track) && !(track < t))
+                {
+                    key = &t;
+                    found.emplace_back(position, params);
+                }
+                ++position;
+            }
+            return found;
+        }
+
+        // Puts the removed entries back at their positions. Either all of
+        // them are restored or, on exception, none.
+        // O(n)
+        void restore(Remove const &remove)
+        {
+            std::vector<typename playlist<T, P>::play_iterator> inserted;
+            inserted.reserve(remove.removed.size());
+            try
+            {
+                auto it = list_.play_begin();
+                size_t position = 0;
+                for (auto const &[target, params] : remove.removed)
+                {
+                    it = std::next(it,
+                        static_cast<std::ptrdiff_t>(target - position));
+                    it = list_.insert(it, remove.track, params);
+                    inserted.push_back(it);
+                    ++it;
+                    position = target + 1;
+                }
+            }
+            catch (...)
+            {
+                for (auto const &entry : inserted)
+                    list_.erase(entry);
+                throw;
+            }
+        }
+
+        void apply(Record const &rec)
+        {
+            if (auto const *push = std::get_if<PushBack>(&rec))
+                list_.push_back(push->track, push->params);
+            else if (std::holds_alternative<PopFront>(rec))
+                list_.pop_front();
+            else if (auto const *remove = std::get_if<Remove>(&rec))
+                list_.remove(remove->track);
+            else
+                list_ = playlist<T, P>();
+        }
+
+        void revert(Record &rec)
+        {
+            if (std::holds_alternative<PushBack>(rec))
+            {
+                list_.erase(std::prev(list_.play_end()));
+            }
+            else if (auto const *pop = std::get_if<PopFront>(&rec))
+            {
+                list_.insert(list_.play_begin(), pop->track, pop->params);
+            }
+            else if (auto const *remove = std::get_if<Remove>(&rec))
+            {
+                restore(*remove);
+            }
+            else
+            {
+                // Moved, so that the next modification does not find the
+                // data shared and copy it; redo() takes it back.
+                list_ = std::move(std::get<Clear>(rec).before);
+            }
+        }
+
+    public:
+        // Creates an empty playlist remembering modifications of up to
+        // history_limit entries in total.
+        explicit undo_playlist(size_t history_limit = 1 << 16)
+            : history_limit_(history_limit) {}
+
+        // O(log n)
+        void push_back(T const &track, P const &params)
+        {
+            record(PushBack{track, params},
+                [&] { list_.push_back(track, params); });
+        }
+
+        // O(log n)
+        void pop_front()
+        {
+            if (list_.size() == 0)
+                throw std::out_of_range("pop_front, playlist empty");
+            auto [track, params] = list_.front();
+            record(PopFront{track, params}, [&] { list_.pop_front(); });
+        }
+
+        // Walks the play order once to note the positions of the entries.
+        // O(n + k log n)
+        void remove(T const &track)
+        {
+            auto removed = occurrences(track);
+            if (removed.empty())
+                throw std::invalid_argument("remove, unknown track");
+            record(Remove{track, std::move(removed)},
+                [&] { list_.remove(track); });
+        }
+
+        // The old data moves into the history, so clearing is O(const).
+        void clear()
+        {
+            record(Clear{list_, list_.size()}, [&] { list_.clear(); });
+        }
+
+        bool can_undo() const noexcept
+        {
+            return !undo_.empty();
+        }
+
+        bool can_redo() const noexcept
+        {
+            return !redo_.empty();
+        }
+
+        // Reverts the last modification. On exception nothing changes.
+        // O(log n), O(n) for remove(), O(const) for clear().
+        void undo()
+        {
+            if (undo_.empty())
+                throw std::out_of_range("undo, nothing to undo");
+            redo_.push_front(std::move(undo_.back()));
+            undo_.pop_back();
+            try
+            {
+                revert(redo_.front());
+            }
+            catch (...)
+            {
+                undo_.push_back(std::move(redo_.front()));
+                redo_.pop_front();
+                throw;
+            }
+        }
+
+        // Applies the last undone modification again. On exception nothing
+        // changes.
+        // Same cost as the modification.
+        void redo()
+        {
+            if (redo_.empty())
+                throw std::out_of_range("redo, nothing to redo");
+            if (auto *clear = std::get_if<Clear>(&redo_.front()))
+                clear->before = std::move(list_);
+            apply(redo_.front());
+            undo_.push_back(std::move(redo_.front()));
+            redo_.pop_front();
+        }
+
+        // Gets the number of entries held by the history.
+        size_t history_entries() const noexcept
+        {
+            return history_entries_;
+        }
+
+        // Read access to the playlist.
+        playlist<T, P> const &get() const noexcept
+        {
+            return list_;
+        }
+    };
+
+} // namespace cxx
+
+#endif // UNDO_PLAYLIST_H